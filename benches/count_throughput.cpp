@@ -0,0 +1,113 @@
+// Measure the throughput of counting the queries of a TSV file (the hot path
+// of top and distinct), once parsed, single threaded.
+//
+// Compares the node based std containers, keyed by copies or views of the
+// queries, with the ranker and the interner (see ranker.h and interner.h).
+//
+// Output: one "method Mqueries/s" line per method, the best of a few runs.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../src/delimiters.h"
+#include "../src/interner.h"
+#include "../src/mapped_file.h"
+#include "../src/ranker.h"
+#include "../src/row.h"
+
+namespace {
+
+const int Runs = 5;
+
+//! The queries of the valid rows of a buffer, in order.
+std::vector<std::string_view> parseQueries(std::string_view data)
+{
+    DelimiterScanner scanner(data);
+    LogRow row;
+    std::vector<std::string_view> queries;
+    for (std::size_t pos = 0; pos < data.size();) {
+        scanner.parseLine(pos, row);
+        if (row.status == RowStatus::Valid)
+            queries.push_back(std::get<1>(row.fields));
+    }
+    return queries;
+}
+
+template <typename F>
+void measure(const char* method, const std::vector<std::string_view>& queries, F count)
+{
+    double best = 0;
+    std::size_t distinct = 0;
+    for (int run = 0; run < Runs; run++) {
+        auto start = std::chrono::steady_clock::now();
+        distinct = count(queries);
+        std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+        best = std::max(best, queries.size() / wall.count() / 1e6);
+    }
+    std::printf("%-28s %7.1f Mqueries/s (%zu distinct)\n", method, best, distinct);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: count_throughput log.tsv\n");
+        return EXIT_FAILURE;
+    }
+
+    auto file = MappedFile::open(argv[1]);
+    if (!file) {
+        std::fprintf(stderr, "count_throughput: %s is not a readable regular file\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    std::vector<std::string_view> queries = parseQueries(file->contents());
+    std::printf("%zu queries\n", queries.size());
+
+    measure("unordered_map<string>", queries, [](const std::vector<std::string_view>& qs) {
+        std::unordered_map<std::string, unsigned int> counts;
+        for (std::string_view query : qs)
+            counts[std::string(query)]++;
+        return counts.size();
+    });
+    measure("unordered_map<string_view>", queries, [](const std::vector<std::string_view>& qs) {
+        std::unordered_map<std::string_view, unsigned int> counts;
+        for (std::string_view query : qs)
+            counts[query]++;
+        return counts.size();
+    });
+    measure("ranker", queries, [](const std::vector<std::string_view>& qs) {
+        MaxOccurrenceRanker ranker(10, StringInterner::Storage::View);
+        for (std::string_view query : qs)
+            ranker.update(query);
+        return ranker.size();
+    });
+
+    measure("unordered_set<string>", queries, [](const std::vector<std::string_view>& qs) {
+        std::unordered_set<std::string> distinct;
+        for (std::string_view query : qs)
+            distinct.emplace(query);
+        return distinct.size();
+    });
+    measure("unordered_set<string_view>", queries, [](const std::vector<std::string_view>& qs) {
+        std::unordered_set<std::string_view> distinct;
+        for (std::string_view query : qs)
+            distinct.insert(query);
+        return distinct.size();
+    });
+    measure("interner", queries, [](const std::vector<std::string_view>& qs) {
+        StringInterner distinct(StringInterner::Storage::View);
+        for (std::string_view query : qs)
+            distinct.intern(query);
+        return distinct.size();
+    });
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+// Generate a synthetic HN Search query log, reproducibly from a seed.
+//
+// Query popularity follows a Zipf distribution, timestamps are spread over a
+// time span, either sorted or partially shuffled.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+namespace {
+
+struct Parameters
+{
+    std::uint64_t lines = 1000000;
+    std::uint64_t queries = 100000;
+    double zipf = 1.0;
+    std::uint64_t start = 1438387200; // 2015-08-01
+    std::uint64_t span = 3 * 24 * 3600;
+    double disorder = 0.0;
+    std::uint64_t seed = 42;
+};
+
+void printUsage(std::ostream& output)
+{
+    output << "Usage: generate_logs [options] > log.tsv"
+        << "\n\nOptions:"
+        << "\n  --lines N        Number of lines. Defaults to 1000000"
+        << "\n  --queries N      Number of distinct queries to draw from. Defaults to 100000"
+        << "\n  --zipf S         Exponent of the Zipf popularity of queries. Defaults to 1.0"
+        << "\n  --start T        First timestamp. Defaults to 1438387200"
+        << "\n  --span SECONDS   Time span of the log. Defaults to 3 days"
+        << "\n  --disorder F     Fraction of lines with a random timestamp (0 is sorted). Defaults to 0"
+        << "\n  --seed N         Random seed. Defaults to 42"
+        << std::endl;
+}
+
+//! Generate the text of the query of a given rank.
+std::string makeQuery(std::uint64_t rank, std::mt19937_64& rng)
+{
+    static const char Alphabet[] = "abcdefghijklmnopqrstuvwxyz";
+
+    std::uniform_int_distribution<int> wordCount(1, 4);
+    std::uniform_int_distribution<int> wordLength(2, 10);
+    std::uniform_int_distribution<int> letter(0, sizeof(Alphabet) - 2);
+
+    // mix of urlencoded URLs and search terms, as in the real logs
+    std::string query = rank % 3 == 0 ? "http%3A%2F%2F" : "";
+    int words = wordCount(rng);
+    for (int w = 0; w < words; w++) {
+        if (w > 0)
+            query += "%20";
+        int length = wordLength(rng);
+        for (int i = 0; i < length; i++)
+            query += Alphabet[letter(rng)];
+    }
+
+    // make sure queries are distinct
+    query += std::to_string(rank);
+    return query;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    static const struct option longopts[] = {
+        { "lines", required_argument, nullptr, 'l' },
+        { "queries", required_argument, nullptr, 'q' },
+        { "zipf", required_argument, nullptr, 'z' },
+        { "start", required_argument, nullptr, 's' },
+        { "span", required_argument, nullptr, 'p' },
+        { "disorder", required_argument, nullptr, 'd' },
+        { "seed", required_argument, nullptr, 'r' },
+        { "help", no_argument, nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 },
+    };
+
+    Parameters params;
+    int id;
+    while ((id = getopt_long(argc, argv, "h", longopts, nullptr)) != -1) {
+        switch (id) {
+            case 'l': params.lines = std::strtoull(optarg, nullptr, 10); break;
+            case 'q': params.queries = std::max<std::uint64_t>(1, std::strtoull(optarg, nullptr, 10)); break;
+            case 'z': params.zipf = std::strtod(optarg, nullptr); break;
+            case 's': params.start = std::strtoull(optarg, nullptr, 10); break;
+            case 'p': params.span = std::strtoull(optarg, nullptr, 10); break;
+            case 'd': params.disorder = std::strtod(optarg, nullptr); break;
+            case 'r': params.seed = std::strtoull(optarg, nullptr, 10); break;
+            case 'h':
+                printUsage(std::cout);
+                return EXIT_SUCCESS;
+            default:
+                printUsage(std::cerr);
+                return EXIT_FAILURE;
+        }
+    }
+
+    std::mt19937_64 rng(params.seed);
+
+    std::vector<std::string> queries;
+    queries.reserve(params.queries);
+    for (std::uint64_t rank = 0; rank < params.queries; rank++)
+        queries.push_back(makeQuery(rank, rng));
+
+    // cumulative distribution of the query ranks
+    std::vector<double> cdf(params.queries);
+    double total = 0;
+    for (std::uint64_t rank = 0; rank < params.queries; rank++) {
+        total += 1.0 / std::pow(rank + 1, params.zipf);
+        cdf[rank] = total;
+    }
+
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::uniform_int_distribution<std::uint64_t> anyTime(0, params.span);
+
+    std::string buffer;
+    for (std::uint64_t i = 0; i < params.lines; i++) {
+        std::uint64_t offset = params.lines > 1 ? params.span * i / (params.lines - 1) : 0;
+        if (uniform(rng) < params.disorder)
+            offset = anyTime(rng);
+
+        auto rank = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng) * total) - cdf.begin();
+        rank = std::min<std::ptrdiff_t>(rank, params.queries - 1);
+
+        buffer += std::to_string(params.start + offset);
+        buffer += '\t';
+        buffer += queries[rank];
+        buffer += '\n';
+
+        if (buffer.size() > (1 << 20)) {
+            std::cout.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    std::cout.write(buffer.data(), buffer.size());
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,50 @@
+// Run a command, then print its wall time, CPU time and peak RSS on stderr
+// (including the processes it waited for, e.g. the stages of a pipeline).
+//
+// Output: wall_seconds user_seconds system_seconds peak_rss_kilobytes
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: measure command [arguments...]\n");
+        return EXIT_FAILURE;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        std::perror("fork");
+        return EXIT_FAILURE;
+    }
+
+    if (pid == 0) {
+        execvp(argv[1], argv + 1);
+        std::perror(argv[1]);
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) == -1) {
+        std::perror("wait4");
+        return EXIT_FAILURE;
+    }
+
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+    std::fprintf(stderr, "%.3f %.3f %.3f %ld\n",
+                 wall.count(),
+                 usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6,
+                 usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6,
+                 usage.ru_maxrss);
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+}
@@ -0,0 +1,119 @@
+// Measure the parse-only throughput of a TSV file: parsing all its lines into
+// (timestamp, query) rows, without aggregating them, single threaded.
+//
+// Compares splitting each line into a vector of fields (memchr() for the
+// newline, then one find() per tab) before parsing the timestamp, with
+// parsing rows in place with the DelimiterScanner kernels supported by the
+// CPU.
+//
+// Output: one "method GB/s" line per method, the best of a few runs.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/delimiters.h"
+#include "../src/mapped_file.h"
+#include "../src/row.h"
+#include "../src/timestamp.h"
+
+namespace {
+
+const int Runs = 5;
+
+//! Split a line into its tab separated fields.
+void splitRow(std::string_view line, std::vector<std::string_view>& row)
+{
+    row.clear();
+
+    std::size_t pos = 0;
+    do {
+        std::size_t tabPos = line.find('\t', pos);
+        row.emplace_back(line.substr(pos, tabPos - pos));
+        pos = tabPos + 1;
+    } while (pos != 0); // npos + 1
+}
+
+//! Parse all the lines of a buffer searching the newline, then the tabs.
+//!
+//! @return The number of valid rows.
+std::size_t splitLinesThenFields(std::string_view data)
+{
+    std::vector<std::string_view> row;
+    std::size_t rows = 0;
+    for (std::size_t pos = 0; pos < data.size();) {
+        const char* begin = data.data() + pos;
+        auto newline = static_cast<const char*>(std::memchr(begin, '\n', data.size() - pos));
+        std::size_t length = newline ? static_cast<std::size_t>(newline - begin) : data.size() - pos;
+
+        splitRow(std::string_view(begin, length), row);
+        if (row.size() == 2 && Timestamp::parse(row[0]))
+            rows++;
+        pos += length + 1;
+    }
+    return rows;
+}
+
+//! Parse all the lines of a buffer in a single pass.
+//!
+//! @return The number of valid rows.
+std::size_t parseDelimited(std::string_view data, DelimiterKernel kernel)
+{
+    DelimiterScanner scanner(data, kernel);
+    LogRow row;
+    std::size_t rows = 0;
+    for (std::size_t pos = 0; pos < data.size();) {
+        scanner.parseLine(pos, row);
+        if (row.status == RowStatus::Valid)
+            rows++;
+    }
+    return rows;
+}
+
+template <typename F>
+void measure(const char* method, std::string_view data, F split)
+{
+    double best = 0;
+    std::size_t rows = 0;
+    for (int run = 0; run < Runs; run++) {
+        auto start = std::chrono::steady_clock::now();
+        rows = split(data);
+        std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+        best = std::max(best, data.size() / wall.count() / 1e9);
+    }
+    std::printf("%-16s %6.2f GB/s (%zu valid rows)\n", method, best, rows);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: parse_throughput log.tsv\n");
+        return EXIT_FAILURE;
+    }
+
+    auto file = MappedFile::open(argv[1]);
+    if (!file) {
+        std::fprintf(stderr, "parse_throughput: %s is not a readable regular file\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    std::string_view data = file->contents();
+
+    // fault the mapping in, so that the first method doesn't pay for it
+    std::size_t lines = std::count(data.begin(), data.end(), '\n');
+    std::printf("%zu lines, %.1f MB\n", lines, data.size() / 1e6);
+
+    measure("vector rows", data, splitLinesThenFields);
+    for (DelimiterKernel kernel : { DelimiterKernel::Scalar, DelimiterKernel::Sse2, DelimiterKernel::Avx2 }) {
+        if (isSupported(kernel))
+            measure(nameOf(kernel), data, [kernel](std::string_view d) { return parseDelimited(d, kernel); });
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+#!/bin/bash
+# Reproducible end-to-end benchmark of hnStat against the shell baselines of
+# hnStat.sh, on a seeded synthetic log (see generate_logs.cpp).
+#
+# Usage: benches/run.sh BUILD_DIR (or `make bench` from the build directory)
+#
+# The shape of the log is set from the environment:
+#   LINES (1000000), QUERIES (100000), ZIPF (1.0), SPAN (259200 seconds),
+#   DISORDER (0, the fraction of out of order lines), SEED (42)
+# and the benchmark matrix with TOP_NS ("10 100") and THREADS (all cores).
+#
+# Throughputs are relative to the whole log, even for narrower ranges.
+
+set -euo pipefail
+
+BUILD_DIR=${1:?usage: $0 BUILD_DIR}
+SOURCE_DIR=$(cd "$(dirname "$0")/.." && pwd)
+
+LINES=${LINES:-1000000}
+QUERIES=${QUERIES:-100000}
+ZIPF=${ZIPF:-1.0}
+SPAN=${SPAN:-259200}
+DISORDER=${DISORDER:-0}
+SEED=${SEED:-42}
+TOP_NS=${TOP_NS:-10 100}
+THREADS=${THREADS:-$(nproc)}
+
+START=1438387200
+
+HNSTAT="$BUILD_DIR/hnStat"
+MEASURE="$BUILD_DIR/measure"
+PARSE_THROUGHPUT="$BUILD_DIR/parse_throughput"
+COUNT_THROUGHPUT="$BUILD_DIR/count_throughput"
+
+LOG="$BUILD_DIR/bench_${LINES}_${QUERIES}_${ZIPF}_${SPAN}_${DISORDER}_${SEED}.tsv"
+if [ ! -f "$LOG" ]; then
+    echo "generating $LOG" >&2
+    "$BUILD_DIR/generate_logs" --lines "$LINES" --queries "$QUERIES" --zipf "$ZIPF" \
+        --start "$START" --span "$SPAN" --disorder "$DISORDER" --seed "$SEED" > "$LOG"
+fi
+rm -f "$LOG.idx"
+
+LOG_BYTES=$(stat -c %s "$LOG")
+
+# name, from, to (empty for unbounded)
+RANGES=(
+    "all||"
+    "half|$START|$((START + SPAN / 2))"
+    "1h|$((START + SPAN / 2))|$((START + SPAN / 2 + 3600))"
+)
+
+# measure NAME RANGE COMMAND...
+measure() {
+    local name=$1 range=$2
+    shift 2
+
+    local stats
+    stats=$("$MEASURE" "$@" 2>&1 >/dev/null | tail -n 1)
+
+    local wall user sys rss
+    read -r wall user sys rss <<< "$stats"
+    awk -v name="$name" -v range="$range" -v wall="$wall" -v rss="$rss" \
+        -v lines="$LINES" -v bytes="$LOG_BYTES" 'BEGIN {
+        if (wall <= 0) wall = 0.001;
+        printf "%-38s %-5s %8.3f %12.0f %9.1f %9.1f\n", name, range, wall, lines / wall, bytes / wall / 1e6, rss / 1024
+    }'
+}
+
+# runs one of the hnStat.sh functions
+BASELINE=(bash -c ". \"$SOURCE_DIR/hnStat.sh\"; \"\$@\"" _)
+
+printf "log: %s (%d lines, %.1f MB)\n\n" "$LOG" "$LINES" "$(awk -v b="$LOG_BYTES" 'BEGIN { print b / 1e6 }')"
+echo "parse only (single thread):"
+"$PARSE_THROUGHPUT" "$LOG" | tail -n +2
+echo
+echo "count only (single thread):"
+"$COUNT_THROUGHPUT" "$LOG" | tail -n +2
+echo
+
+printf "%-38s %-5s %8s %12s %9s %9s\n" "command" "range" "wall (s)" "lines/s" "MB/s" "peak MB"
+
+HNSTAT_VARIANTS=("--threads 1")
+if [ "$THREADS" != "1" ]; then
+    HNSTAT_VARIANTS+=("--threads $THREADS")
+fi
+if [ "$DISORDER" = "0" ]; then
+    HNSTAT_VARIANTS+=("--threads $THREADS --sorted")
+fi
+
+for range in "${RANGES[@]}"; do
+    IFS='|' read -r range_name from to <<< "$range"
+
+    bounds=()
+    [ -n "$from" ] && bounds+=(--from "$from")
+    [ -n "$to" ] && bounds+=(--to "$to")
+
+    for n in $TOP_NS; do
+        for variant in "${HNSTAT_VARIANTS[@]}"; do
+            # shellcheck disable=SC2086
+            measure "hnStat top $n $variant" "$range_name" "$HNSTAT" top "$n" ${bounds[@]+"${bounds[@]}"} $variant "$LOG"
+        done
+        measure "baseline top $n" "$range_name" "${BASELINE[@]}" hnStatTop "$LOG" "$n" "$from" "$to"
+    done
+
+    for variant in "${HNSTAT_VARIANTS[@]}"; do
+        # shellcheck disable=SC2086
+        measure "hnStat distinct $variant" "$range_name" "$HNSTAT" distinct ${bounds[@]+"${bounds[@]}"} $variant "$LOG"
+    done
+    measure "baseline distinct" "$range_name" "${BASELINE[@]}" hnStatDistinct "$LOG" "$from" "$to"
+done
@@ -1,2 +1,6 @@
-hnStatTop() { cut -d'	' -f2 $1 | sort | uniq -c | sort -n -k 1 -r | head -n $2; }
-hnStatDistinct() { cut -d'	' -f2 $1 | sort -u | wc -l; }
+# Shell baselines of the hnStat commands, with optional (inclusive) bounds:
+#   hnStatTop input_file nb_top_queries [from] [to]
+#   hnStatDistinct input_file [from] [to]
+hnStatQueries() { if [ -z "$2$3" ]; then cut -d'	' -f2 $1; else awk -F'\t' -v from="${2:-0}" -v to="${3:-1e300}" '$1 >= from+0 && $1 <= to+0 { print $2 }' $1; fi; }
+hnStatTop() { hnStatQueries $1 "$3" "$4" | sort | uniq -c | sort -n -k 1 -r | head -n $2; }
+hnStatDistinct() { hnStatQueries $1 "$2" "$3" | sort -u | wc -l; }
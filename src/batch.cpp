@@ -0,0 +1,168 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "commands.h"
+#include "interner.h"
+#include "ranker.h"
+#include "stats.h"
+#include "tsv_reader.h"
+
+namespace {
+
+//! Accumulates the answers of a batch of requests.
+class Batch
+{
+public:
+    Batch(const std::vector<Request>& requests, StringInterner::Storage storage):
+        requests_(requests)
+    {
+        for (const Request& request : requests_) {
+            switch (request.command) {
+                case Request::Command::Top:
+                    slots_.push_back(rankers_.size());
+                    rankers_.emplace_back(request.n, storage);
+                    break;
+
+                case Request::Command::Distinct:
+                    slots_.push_back(queries_.size());
+                    queries_.emplace_back(storage);
+                    break;
+            }
+        }
+    }
+
+    //! Add a row to all the requests whose range contains it.
+    void add(const Timestamp& timestamp, std::string_view query)
+    {
+        for (std::size_t i = 0; i < requests_.size(); i++) {
+            const ScanOptions& range = requests_[i].scan;
+            if (timestamp < range.from || range.to < timestamp)
+                continue;
+
+            if (requests_[i].command == Request::Command::Top) {
+                rankers_[slots_[i]].update(query);
+            } else {
+                queries_[slots_[i]].intern(query);
+            }
+        }
+    }
+
+    void merge(const Batch& other)
+    {
+        for (std::size_t i = 0; i < rankers_.size(); i++)
+            rankers_[i].merge(other.rankers_[i]);
+
+        for (std::size_t i = 0; i < queries_.size(); i++) {
+            const StringInterner& other_queries = other.queries_[i];
+            for (StringInterner::Id id = 0; id < other_queries.size(); id++)
+                queries_[i].intern(other_queries.get(id));
+        }
+    }
+
+    void print(std::ostream& output) const
+    {
+        for (std::size_t i = 0; i < requests_.size(); i++) {
+            output << "# " << requests_[i].text << '\n';
+            if (requests_[i].command == Request::Command::Top) {
+                rankers_[slots_[i]].visit([&output](std::string_view query, unsigned int count) {
+                    output << query << ' ' << count << '\n';
+                });
+            } else {
+                output << queries_[slots_[i]].size() << '\n';
+            }
+        }
+        output.flush();
+    }
+
+private:
+    const std::vector<Request>& requests_;
+
+    // accumulators of the requests, by command
+    std::vector<MaxOccurrenceRanker> rankers_;
+    std::vector<StringInterner> queries_;
+
+    // index of the accumulator of each request
+    std::vector<std::size_t> slots_;
+};
+
+//! Union of the ranges of a batch of requests.
+std::pair<Timestamp, Timestamp> rangeOf(const std::vector<Request>& requests)
+{
+    Timestamp from = Timestamp::Max;
+    Timestamp to = Timestamp::Min;
+    for (const Request& request : requests) {
+        from = std::min(from, request.scan.from);
+        to = std::max(to, request.scan.to);
+    }
+    return { from, to };
+}
+
+//! Add all valid rows of a reader to a batch, stopping after the given
+//! timestamp if the input is sorted.
+template <typename Reader>
+void addRows(Reader& reader, Batch& batch, const Timestamp& to, bool sorted)
+{
+    onValidLines(reader, [&](const Timestamp& timestamp, std::string_view query) {
+        if (sorted && to < timestamp)
+            return false;
+        batch.add(timestamp, query);
+        return true;
+    });
+}
+
+} // namespace
+
+void printBatch(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, const std::vector<Request>& requests)
+{
+    Batch batch(requests, StringInterner::Storage::Copy);
+    if (!requests.empty())
+        addRows(input, batch, rangeOf(requests).second, scan.sorted);
+    batch.print(output);
+}
+
+void printBatch(std::string_view input, std::ostream& output, const ScanOptions& scan, const std::vector<Request>& requests)
+{
+    Batch batch(requests, StringInterner::Storage::View);
+    if (requests.empty()) {
+        batch.print(output);
+        return;
+    }
+
+    auto [from, to] = rangeOf(requests);
+    if (scan.sorted)
+        input = findSortedRange(input, from, to);
+
+    auto chunk_batches = mapChunks(input, scan.threads, [&](std::string_view chunk) {
+        Batch chunk_batch(requests, StringInterner::Storage::View);
+        MemoryTSVReader reader(chunk);
+        addRows(reader, chunk_batch, to, scan.sorted);
+        return chunk_batch;
+    });
+
+    {
+        Stats::ScopedPhase phase(Stats::Phase::Merge);
+        for (const Batch& other : chunk_batches)
+            batch.merge(other);
+    }
+    batch.print(output);
+}
+
+void printBatch(const Index& index, std::ostream& output, const std::vector<Request>& requests)
+{
+    Index::RangeCounts counts;
+    for (const Request& request : requests) {
+        output << "# " << request.text << '\n';
+        switch (request.command) {
+            case Request::Command::Top:
+                printTopN(index, output, request.scan, request.n, counts);
+                break;
+
+            case Request::Command::Distinct:
+                printDistinctCount(index, output, request.scan);
+                break;
+        }
+    }
+    output.flush();
+}
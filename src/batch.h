@@ -0,0 +1,26 @@
+#pragma once
+
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "index.h"
+#include "pipelined_reader.h"
+#include "request.h"
+#include "scan.h"
+
+//! Print the answers of a batch of requests over a stream, reading it once.
+//!
+//! Each answer is preceded by a `# REQUEST` line, in the order of the
+//! requests.
+void printBatch(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, const std::vector<Request>& requests);
+
+//! Print the answers of a batch of requests over an in-memory buffer, split
+//! between threads, reading it once.
+//!
+//! Each row is routed to all the requests whose range contains it. When the
+//! buffer is sorted, only the lines within the union of the ranges are read.
+void printBatch(std::string_view input, std::ostream& output, const ScanOptions& scan, const std::vector<Request>& requests);
+
+//! Print the answers of a batch of requests over an index.
+void printBatch(const Index& index, std::ostream& output, const std::vector<Request>& requests);
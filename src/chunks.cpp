@@ -0,0 +1,27 @@
+#include "chunks.h"
+
+#include <algorithm>
+
+std::vector<std::string_view> splitLines(std::string_view data, std::size_t n)
+{
+    std::vector<std::string_view> chunks;
+    if (n == 0)
+        n = 1;
+
+    std::size_t begin = 0;
+    for (std::size_t i = 1; i <= n && begin < data.size(); i++) {
+        std::size_t end = data.size();
+        if (i < n) {
+            // move the cut forward to the end of the current line
+            std::size_t cut = std::max(begin, data.size() / n * i);
+            std::size_t newline = data.find('\n', cut);
+            if (newline != std::string_view::npos)
+                end = newline + 1;
+        }
+
+        chunks.push_back(data.substr(begin, end - begin));
+        begin = end;
+    }
+
+    return chunks;
+}
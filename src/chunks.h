@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//! Split a buffer of lines into (at most) `n` chunks of similar size.
+//!
+//! Chunks are only cut right after a newline, so that no line is ever split
+//! between two chunks. Empty chunks are dropped, so less than `n` chunks can
+//! be returned for small inputs.
+std::vector<std::string_view> splitLines(std::string_view data, std::size_t n);
+
+//! Apply `f` to line-aligned chunks of several buffers (e.g. several mapped
+//! files), with `n` threads.
+//!
+//! Each buffer is split in a number of chunks proportional to its size (at
+//! least one per non-empty buffer, about `n` in total), which the threads
+//! take in turn.
+//!
+//! @return The results of `f` for each chunk, in the order of the chunks.
+template <typename F>
+auto mapChunks(const std::vector<std::string_view>& buffers, std::size_t n, F f)
+    -> std::vector<std::invoke_result_t<F, std::string_view>>
+{
+    typedef std::invoke_result_t<F, std::string_view> Result;
+
+    std::size_t total_size = 0;
+    for (std::string_view buffer : buffers)
+        total_size += buffer.size();
+
+    std::vector<std::string_view> chunks;
+    for (std::string_view buffer : buffers) {
+        if (buffer.empty())
+            continue;
+        auto buffer_chunks = splitLines(buffer, (n * buffer.size() + total_size - 1) / total_size);
+        chunks.insert(chunks.end(), buffer_chunks.begin(), buffer_chunks.end());
+    }
+
+    std::vector<Result> results;
+    if (chunks.empty())
+        return results;
+
+    // results aren't required to be default constructible
+    std::vector<std::optional<Result>> chunk_results(chunks.size());
+
+    std::atomic<std::size_t> next_chunk(0);
+    auto work = [&] {
+        for (std::size_t i; (i = next_chunk++) < chunks.size();)
+            chunk_results[i].emplace(f(chunks[i]));
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < std::min(n, chunks.size()); i++)
+        workers.emplace_back(work);
+
+    // the calling thread works too
+    work();
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    results.reserve(chunks.size());
+    for (std::optional<Result>& result : chunk_results)
+        results.push_back(std::move(*result));
+    return results;
+}
+
+//! Apply `f` to `n` line-aligned chunks of `data`, each in its own thread.
+//!
+//! @return The results of `f` for each chunk, in the order of the chunks.
+template <typename F>
+auto mapChunks(std::string_view data, std::size_t n, F f)
+    -> std::vector<std::invoke_result_t<F, std::string_view>>
+{
+    return mapChunks(std::vector<std::string_view>{ data }, n, f);
+}
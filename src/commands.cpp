@@ -0,0 +1,657 @@
+#include "commands.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <deque>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "histogram.h"
+#include "hyperloglog.h"
+#include "interner.h"
+#include "partial.h"
+#include "ranker.h"
+#include "space_saving.h"
+#include "spilling_counter.h"
+#include "stats.h"
+#include "tsv_reader.h"
+
+namespace {
+
+//! Print ranked queries, optionally followed by the error bound of their
+//! count (always 0, since the rankers are exact).
+template <typename Ranker>
+void printRanked(std::ostream& output, const Ranker& ranker, bool with_errors = false)
+{
+    Stats::global().setTable(ranker.size(), ranker.bucketCount());
+
+    {
+        Stats::ScopedPhase phase(Stats::Phase::Rank);
+        ranker.visit([&](std::string_view query, unsigned int count) {
+            output << query << ' ' << count;
+            if (with_errors)
+                output << " 0";
+            output << '\n';
+        });
+    }
+
+    Stats::ScopedPhase phase(Stats::Phase::Output);
+    output.flush();
+}
+
+//! Print the estimated top `n` queries, each followed by the maximum
+//! overestimation of its count.
+void printApproxRanked(std::ostream& output, const SpaceSaving& summary, unsigned int n)
+{
+    {
+        Stats::ScopedPhase phase(Stats::Phase::Rank);
+        summary.visit(n, [&output](std::string_view query, unsigned int count, unsigned int error) {
+            output << query << ' ' << count << ' ' << error << '\n';
+        });
+    }
+
+    Stats::ScopedPhase phase(Stats::Phase::Output);
+    output.flush();
+}
+
+//! Add the valid rows of a reader to an index.
+//!
+//! @return false if the rows have too many distinct queries to be indexed.
+template <typename Reader>
+bool addRows(Reader& reader, Index::Builder& builder)
+{
+    bool added = true;
+    onValidLines(reader, [&](const Timestamp& timestamp, std::string_view query) {
+        added = builder.add(timestamp, query);
+        return added;
+    });
+    return added;
+}
+
+//! Print the top `n` queries of the windows of a time-sorted reader (see
+//! `printWindowedTopN()`).
+template <typename Reader>
+void printWindows(Reader& reader, std::ostream& output, const ScanOptions& scan, unsigned int n,
+                  Timestamp::Value window, Timestamp::Value step, StringInterner::Storage storage)
+{
+    MaxOccurrenceRanker ranker(n, storage);
+
+    // rows of the current window, oldest first
+    std::deque<std::pair<Timestamp::Value, StringInterner::Id>> rows;
+    Timestamp::Value start = scan.from.value();
+    Timestamp::Value last = start;
+
+    // print the current window, then move to the next one, retiring the rows
+    // before it
+    auto nextWindow = [&] {
+        output << "# " << start << ' ' << start + window - 1 << '\n';
+        printRanked(output, ranker);
+
+        start += step;
+        for (; !rows.empty() && rows.front().first < start; rows.pop_front())
+            ranker.remove(rows.front().second);
+
+        // drop the queries which left the windows once they outnumber the
+        // rows, so that ranking a window (and the memory) stays proportional
+        // to its size, however many distinct queries the input has
+        if (ranker.removedCount() > rows.size()) {
+            std::vector<StringInterner::Id> ids = ranker.compact();
+            for (auto& row : rows)
+                row.second = ids[row.second];
+        }
+    };
+
+    onValidLines(reader, [&](const Timestamp& timestamp, std::string_view query) {
+        if (timestamp < scan.from)
+            return true;
+        if (scan.to < timestamp)
+            return false;
+
+        Timestamp::Value t = timestamp.value();
+        if (t < last) {
+            reportInvalidLine(std::to_string(t) + " is before the previous timestamp " + std::to_string(last));
+            return true;
+        }
+        last = t;
+
+        // print the windows ending before the row
+        while (!rows.empty() && t >= start && t - start >= window)
+            nextWindow();
+
+        // skip to the first window ending at or after the row
+        if (rows.empty() && t >= start && t - start >= window)
+            start += ((t - start - window) / step + 1) * step;
+
+        // rows between windows (when the step is larger) are in none
+        if (t >= start)
+            rows.emplace_back(t, ranker.update(query));
+        return true;
+    });
+
+    // print the windows still holding rows (several when they overlap)
+    while (!rows.empty())
+        nextWindow();
+}
+
+//! Print the top `n` queries of a counter, only keeping the `n` best
+//! candidates in memory while its partitions are aggregated.
+//!
+//! @return false if the counts couldn't be spilled.
+bool printCounted(std::ostream& output, SpillingCounter& counter, unsigned int n)
+{
+    // highest counts first, ties broken by query, the worst candidate on top
+    typedef std::pair<SpillingCounter::Count, std::string> Candidate;
+    auto better = [](const Candidate& lhs, const Candidate& rhs) {
+        return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+    };
+    std::priority_queue<Candidate, std::vector<Candidate>, decltype(better)> candidates(better);
+
+    bool counted;
+    std::size_t distinct = 0;
+    {
+        Stats::ScopedPhase phase(Stats::Phase::Merge);
+        counted = counter.visit([&](std::string_view query, SpillingCounter::Count count) {
+            distinct++;
+            if (candidates.size() == n) {
+                const Candidate& worst = candidates.top();
+                if (count < worst.first || (count == worst.first && query >= worst.second))
+                    return;
+                candidates.pop();
+            }
+            candidates.emplace(count, std::string(query));
+        });
+    }
+    if (!counted)
+        return false;
+
+    MaxOccurrenceRanker ranker(n);
+    for (; !candidates.empty(); candidates.pop())
+        ranker.update(candidates.top().second, candidates.top().first);
+    printRanked(output, ranker);
+
+    // the ranker only holds the candidates, and the counts were spread over
+    // the tables of the spilled partitions: only the number of distinct
+    // queries describes the result
+    Stats::global().setTable(distinct, 0);
+    return true;
+}
+
+//! Count the queries of in-memory buffers split between threads, each
+//! thread counting its chunk within its share of `memory_limit`.
+SpillingCounter countChunks(const std::vector<std::string_view>& inputs, const ScanOptions& scan, std::size_t memory_limit)
+{
+    // there are at most a chunk per thread and one more per buffer, each
+    // getting at least the memory of a small table, so that many buffers
+    // don't make their chunks spill on almost every new query
+    const std::size_t MinChunkMemoryLimit = 256 << 10;
+    std::size_t chunk_memory_limit = std::max(memory_limit / (scan.threads + inputs.size()), MinChunkMemoryLimit);
+    auto chunk_counters = accumulateChunks(inputs, scan,
+                                           [=] { return SpillingCounter(chunk_memory_limit, StringInterner::Storage::View); },
+                                           [](SpillingCounter& counter, std::string_view q) { counter.add(q); });
+
+    // the merged counter gets the share of the chunk counters as they are
+    // merged and freed, so that they never hold more than the limit together
+    std::size_t held = chunk_memory_limit * chunk_counters.size();
+    auto mergedLimit = [&] {
+        return std::max(memory_limit > held ? memory_limit - held : 0, chunk_memory_limit);
+    };
+
+    SpillingCounter counter(mergedLimit(), StringInterner::Storage::View);
+    {
+        Stats::ScopedPhase phase(Stats::Phase::Merge);
+        for (SpillingCounter& other : chunk_counters) {
+            SpillingCounter merged(std::move(other));
+            counter.merge(std::move(merged));
+            held -= chunk_memory_limit;
+            counter.setMemoryLimit(mergedLimit());
+        }
+    }
+    return counter;
+}
+
+//! Estimate the distinct queries of in-memory buffers split between
+//! threads, each thread filling its own sketch.
+HyperLogLog sketchChunks(const std::vector<std::string_view>& inputs, const ScanOptions& scan, unsigned int precision)
+{
+    auto chunk_sketches = accumulateChunks(inputs, scan,
+                                           [precision] { return HyperLogLog(precision); },
+                                           [](HyperLogLog& sketch, std::string_view q) { sketch.add(q); });
+
+    HyperLogLog sketch(precision);
+    {
+        Stats::ScopedPhase phase(Stats::Phase::Merge);
+        for (const HyperLogLog& other : chunk_sketches)
+            sketch.merge(other);
+    }
+    return sketch;
+}
+
+//! Sum the counts of partial aggregates, the counter referencing their
+//! queries.
+SpillingCounter mergeCounts(const std::vector<Partial>& partials, std::size_t memory_limit)
+{
+    SpillingCounter counter(memory_limit, StringInterner::Storage::View);
+    Stats::ScopedPhase phase(Stats::Phase::Merge);
+    for (const Partial& partial : partials) {
+        partial.visit([&](std::string_view query, SpillingCounter::Count count) {
+            counter.add(query, count);
+        });
+    }
+    return counter;
+}
+
+//! Add a row to a histogram, reporting it if it can't be.
+void addRow(Histogram& histogram, const Timestamp& timestamp, std::string_view query)
+{
+    if (!histogram.add(timestamp, query))
+        reportInvalidLine(std::to_string(timestamp.value()) + " is more than 2^32 buckets after the origin");
+}
+
+//! Print the buckets of a histogram, one `START TOTAL DISTINCT` line each.
+void printBuckets(std::ostream& output, const Histogram& histogram)
+{
+    Stats::ScopedPhase phase(Stats::Phase::Output);
+    histogram.visit([&](Timestamp::Value start, std::uint64_t total, std::uint64_t distinct) {
+        output << start << ' ' << total << ' ' << distinct << '\n';
+    });
+    output.flush();
+}
+
+} // namespace
+
+void printTopN(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, unsigned int n)
+{
+    if (n == 0)
+        return;
+
+    MaxOccurrenceRanker ranker(n);
+
+    // rank queries in the given timestamp range
+    onTimestampRange(input, scan, [&ranker](std::string_view query) {
+        ranker.update(query);
+    });
+
+    // print out the top n elements
+    printRanked(output, ranker);
+}
+
+void printTopN(const std::vector<std::string_view>& inputs, std::ostream& output, const ScanOptions& scan, unsigned int n)
+{
+    if (n == 0)
+        return;
+
+    auto chunk_rankers = accumulateChunks(inputs, scan,
+                                          [n] { return MaxOccurrenceRanker(n, StringInterner::Storage::View); },
+                                          [](MaxOccurrenceRanker& ranker, std::string_view query) { ranker.update(query); });
+    if (chunk_rankers.empty())
+        return;
+
+    MaxOccurrenceRanker ranker(std::move(chunk_rankers.front()));
+    {
+        Stats::ScopedPhase phase(Stats::Phase::Merge);
+        for (std::size_t i = 1; i < chunk_rankers.size(); i++)
+            ranker.merge(chunk_rankers[i]);
+    }
+
+    printRanked(output, ranker);
+}
+
+void printTopN(const Index& index, std::ostream& output, const ScanOptions& scan, unsigned int n, Index::RangeCounts& counts,
+               bool with_errors)
+{
+    if (n == 0)
+        return;
+
+    MaxOccurrenceRanker ranker(n, StringInterner::Storage::View);
+    {
+        Stats::ScopedPhase phase(Stats::Phase::Scan);
+        counts.visit(index, scan.from, scan.to, [&](Index::QueryId id, unsigned int count) {
+            ranker.update(index.query(id), count);
+        });
+    }
+
+    printRanked(output, ranker, with_errors);
+}
+
+void printTopN(const Index& index, std::ostream& output, const ScanOptions& scan, unsigned int n, bool with_errors)
+{
+    Index::RangeCounts counts;
+    printTopN(index, output, scan, n, counts, with_errors);
+}
+
+void followTopN(FollowTSVReader& input, std::ostream& output, const ScanOptions& scan, unsigned int n, std::chrono::seconds interval)
+{
+    if (n == 0)
+        return;
+
+    // the top queries are kept up to date by the updates, so that refreshes
+    // don't go over all the queries read so far
+    GrowingRanker ranker(n);
+    for (;;) {
+        auto next_refresh = std::chrono::steady_clock::now() + interval;
+
+        onTimestampRange(input, scan, [&ranker](std::string_view query) {
+            ranker.update(query);
+        });
+
+        output << "# " << std::time(nullptr) << '\n';
+        printRanked(output, ranker);
+
+        std::this_thread::sleep_until(next_refresh);
+    }
+}
+
+void printWindowedTopN(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, unsigned int n,
+                       Timestamp::Value window, Timestamp::Value step)
+{
+    if (n == 0)
+        return;
+
+    printWindows(input, output, scan, n, window, step, StringInterner::Storage::Copy);
+}
+
+void printWindowedTopN(std::string_view input, std::ostream& output, const ScanOptions& scan, unsigned int n,
+                       Timestamp::Value window, Timestamp::Value step)
+{
+    if (n == 0)
+        return;
+
+    MemoryTSVReader reader(findSortedRange(input, scan.from, scan.to));
+    printWindows(reader, output, scan, n, window, step, StringInterner::Storage::View);
+}
+
+void printDistinctCount(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan)
+{
+    StringInterner queries;
+    onTimestampRange(input, scan,
+                     [&](std::string_view q) { queries.intern(q); });
+
+    Stats::global().setTable(queries.size(), queries.bucketCount());
+    output << queries.size() << std::endl;
+}
+
+void printDistinctCount(const std::vector<std::string_view>& inputs, std::ostream& output, const ScanOptions& scan)
+{
+    auto chunk_queries = accumulateChunks(inputs, scan,
+                                          [] { return StringInterner(StringInterner::Storage::View); },
+                                          [](StringInterner& queries, std::string_view q) { queries.intern(q); });
+
+    StringInterner queries(StringInterner::Storage::View);
+    {
+        Stats::ScopedPhase phase(Stats::Phase::Merge);
+        for (StringInterner& other : chunk_queries) {
+            if (other.size() > queries.size())
+                std::swap(queries, other);
+            for (StringInterner::Id id = 0; id < other.size(); id++)
+                queries.intern(other.get(id));
+        }
+    }
+
+    Stats::global().setTable(queries.size(), queries.bucketCount());
+    output << queries.size() << std::endl;
+}
+
+void printDistinctCount(const Index& index, std::ostream& output, const ScanOptions& scan)
+{
+    std::size_t count;
+    {
+        Stats::ScopedPhase phase(Stats::Phase::Scan);
+        count = index.distinctInRange(scan.from, scan.to);
+    }
+
+    output << count << std::endl;
+}
+
+std::optional<std::string> writeIndex(std::string_view input, const Index::Source& source, const std::string& path)
+{
+    Index::Builder builder;
+    builder.setSource(source);
+    MemoryTSVReader reader(input);
+    if (!addRows(reader, builder))
+        return "too many distinct queries to index";
+    if (!builder.write(path))
+        return "could not write index \"" + path + '"';
+    return std::nullopt;
+}
+
+std::optional<Index> buildIndex(std::string_view input)
+{
+    Index::Builder builder;
+    MemoryTSVReader reader(input);
+    if (!addRows(reader, builder))
+        return std::nullopt;
+    return builder.build();
+}
+
+std::optional<Index> buildIndex(PipelinedTSVReader& input)
+{
+    Index::Builder builder;
+    if (!addRows(input, builder))
+        return std::nullopt;
+    return builder.build();
+}
+
+void printApproxTopN(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, unsigned int n, unsigned int capacity)
+{
+    if (n == 0)
+        return;
+
+    SpaceSaving summary(capacity);
+    onTimestampRange(input, scan,
+                     [&](std::string_view q) { summary.update(q); });
+
+    printApproxRanked(output, summary, n);
+}
+
+void printApproxTopN(const std::vector<std::string_view>& inputs, std::ostream& output, const ScanOptions& scan, unsigned int n, unsigned int capacity)
+{
+    if (n == 0)
+        return;
+
+    auto chunk_summaries = accumulateChunks(inputs, scan,
+                                            [capacity] { return SpaceSaving(capacity); },
+                                            [](SpaceSaving& summary, std::string_view q) { summary.update(q); });
+
+    SpaceSaving summary(capacity);
+    {
+        Stats::ScopedPhase phase(Stats::Phase::Merge);
+        for (const SpaceSaving& other : chunk_summaries)
+            summary.merge(other);
+    }
+
+    printApproxRanked(output, summary, n);
+}
+
+void printApproxDistinctCount(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, unsigned int precision)
+{
+    HyperLogLog sketch(precision);
+    onTimestampRange(input, scan,
+                     [&](std::string_view q) { sketch.add(q); });
+
+    output << std::llround(sketch.estimate()) << std::endl;
+}
+
+void printApproxDistinctCount(const std::vector<std::string_view>& inputs, std::ostream& output, const ScanOptions& scan, unsigned int precision)
+{
+    HyperLogLog sketch = sketchChunks(inputs, scan, precision);
+    output << std::llround(sketch.estimate()) << std::endl;
+}
+
+bool printBoundedTopN(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, unsigned int n, std::size_t memory_limit)
+{
+    if (n == 0)
+        return true;
+
+    SpillingCounter counter(memory_limit);
+    onTimestampRange(input, scan,
+                     [&](std::string_view q) { counter.add(q); });
+
+    return printCounted(output, counter, n);
+}
+
+bool printBoundedTopN(const std::vector<std::string_view>& inputs, std::ostream& output, const ScanOptions& scan, unsigned int n, std::size_t memory_limit)
+{
+    if (n == 0)
+        return true;
+
+    SpillingCounter counter = countChunks(inputs, scan, memory_limit);
+    return printCounted(output, counter, n);
+}
+
+bool printBoundedDistinctCount(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, std::size_t memory_limit)
+{
+    SpillingCounter counter(memory_limit);
+    onTimestampRange(input, scan,
+                     [&](std::string_view q) { counter.add(q); });
+
+    std::size_t distinct = 0;
+    if (!counter.visit([&](std::string_view, SpillingCounter::Count) { distinct++; }))
+        return false;
+
+    output << distinct << std::endl;
+    return true;
+}
+
+bool printBoundedDistinctCount(const std::vector<std::string_view>& inputs, std::ostream& output, const ScanOptions& scan, std::size_t memory_limit)
+{
+    SpillingCounter counter = countChunks(inputs, scan, memory_limit);
+
+    std::size_t distinct = 0;
+    if (!counter.visit([&](std::string_view, SpillingCounter::Count) { distinct++; }))
+        return false;
+
+    output << distinct << std::endl;
+    return true;
+}
+
+void printHistogram(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, Timestamp::Value width)
+{
+    Histogram histogram(scan.from.value(), width);
+    onTimestampRange(input, scan, [&](const Timestamp& timestamp, std::string_view query) {
+        addRow(histogram, timestamp, query);
+    });
+
+    printBuckets(output, histogram);
+}
+
+void printHistogram(const std::vector<std::string_view>& inputs, std::ostream& output, const ScanOptions& scan, Timestamp::Value width)
+{
+    Timestamp::Value origin = scan.from.value();
+    auto chunk_histograms = accumulateChunks(inputs, scan,
+                                             [=] { return Histogram(origin, width, StringInterner::Storage::View); },
+                                             [](Histogram& histogram, const Timestamp& timestamp, std::string_view query) {
+                                                 addRow(histogram, timestamp, query);
+                                             });
+
+    Histogram histogram(origin, width, StringInterner::Storage::View);
+    {
+        Stats::ScopedPhase phase(Stats::Phase::Merge);
+        for (const Histogram& other : chunk_histograms)
+            histogram.merge(other);
+    }
+
+    printBuckets(output, histogram);
+}
+
+bool writePartial(PipelinedTSVReader& input, const std::string& path, const ScanOptions& scan, std::size_t memory_limit)
+{
+    SpillingCounter counter(memory_limit);
+    onTimestampRange(input, scan,
+                     [&](std::string_view q) { counter.add(q); });
+
+    Stats::ScopedPhase phase(Stats::Phase::Output);
+    return Partial::write(path, counter);
+}
+
+bool writePartial(const std::vector<std::string_view>& inputs, const std::string& path, const ScanOptions& scan, std::size_t memory_limit)
+{
+    SpillingCounter counter = countChunks(inputs, scan, memory_limit);
+
+    Stats::ScopedPhase phase(Stats::Phase::Output);
+    return Partial::write(path, counter);
+}
+
+bool writeApproxPartial(PipelinedTSVReader& input, const std::string& path, const ScanOptions& scan, unsigned int precision)
+{
+    HyperLogLog sketch(precision);
+    onTimestampRange(input, scan,
+                     [&](std::string_view q) { sketch.add(q); });
+
+    Stats::ScopedPhase phase(Stats::Phase::Output);
+    return Partial::write(path, sketch);
+}
+
+bool writeApproxPartial(const std::vector<std::string_view>& inputs, const std::string& path, const ScanOptions& scan, unsigned int precision)
+{
+    HyperLogLog sketch = sketchChunks(inputs, scan, precision);
+
+    Stats::ScopedPhase phase(Stats::Phase::Output);
+    return Partial::write(path, sketch);
+}
+
+bool printMergedTopN(const std::vector<Partial>& partials, std::ostream& output, unsigned int n, std::size_t memory_limit)
+{
+    if (n == 0)
+        return true;
+
+    SpillingCounter counter = mergeCounts(partials, memory_limit);
+    return printCounted(output, counter, n);
+}
+
+bool printMergedDistinctCount(const std::vector<Partial>& partials, std::ostream& output, std::size_t memory_limit)
+{
+    auto with_sketch = std::find_if(partials.begin(), partials.end(),
+                                    [](const Partial& partial) { return !partial.hasCounts(); });
+    if (with_sketch == partials.end()) {
+        SpillingCounter counter = mergeCounts(partials, memory_limit);
+
+        std::size_t distinct = 0;
+        if (!counter.visit([&](std::string_view, SpillingCounter::Count) { distinct++; }))
+            return false;
+
+        output << distinct << std::endl;
+        return true;
+    }
+
+    HyperLogLog sketch(with_sketch->sketch()->precision());
+    {
+        Stats::ScopedPhase phase(Stats::Phase::Merge);
+        for (const Partial& partial : partials) {
+            if (partial.hasCounts()) {
+                partial.visit([&](std::string_view query, SpillingCounter::Count) { sketch.add(query); });
+            } else {
+                sketch.merge(*partial.sketch());
+            }
+        }
+    }
+
+    output << std::llround(sketch.estimate()) << std::endl;
+    return true;
+}
+
+std::optional<std::string> parseTimestampRange(const Arguments& arguments, ScanOptions& scan)
+{
+    if (auto timestamp_str = arguments.getOption("from")) {
+        auto timestamp = Timestamp::parse(*timestamp_str);
+        if (!timestamp)
+            return "--from received an invalid timestamp";
+        scan.from = *timestamp;
+    }
+
+    if (auto timestamp_str = arguments.getOption("to")) {
+        auto timestamp = Timestamp::parse(*timestamp_str);
+        if (!timestamp)
+            return "--to received an invalid timestamp";
+        scan.to = *timestamp;
+    }
+
+    if (scan.to < scan.from)
+        return "--from cannot receive a larger timestamp than the one specified with --to";
+
+    return std::nullopt;
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "follow_reader.h"
+#include "index.h"
+#include "options.h"
+#include "partial.h"
+#include "pipelined_reader.h"
+#include "scan.h"
+
+//! Print the top `n` queries of a stream.
+//!
+//! Streams can't be split, so they are always read by a single thread.
+void printTopN(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, unsigned int n);
+
+//! Print the top `n` queries of in-memory buffers, split between threads.
+//!
+//! Each thread counts the queries of its chunk (interned as views into the
+//! buffers), the counts are then merged and ranked.
+void printTopN(const std::vector<std::string_view>& inputs, std::ostream& output, const ScanOptions& scan, unsigned int n);
+
+//! Print the top `n` queries of an index, each optionally followed by the
+//! error bound of its count (always 0, since the counts are exact).
+//!
+//! The counts of the range are summed in `counts` (see `Index::RangeCounts`),
+//! which requests against the same index should share.
+void printTopN(const Index& index, std::ostream& output, const ScanOptions& scan, unsigned int n, Index::RangeCounts& counts,
+               bool with_errors = false);
+
+//! Print the top `n` queries of an index (see above), for a single request.
+void printTopN(const Index& index, std::ostream& output, const ScanOptions& scan, unsigned int n, bool with_errors = false);
+
+//! Print the top `n` queries of a growing file every `interval`, forever.
+//!
+//! Each refresh only reads the rows appended since the previous one, adding
+//! them to the counts of all the rows read so far (see `GrowingRanker`), then
+//! prints a `# TIME` line (in seconds since the epoch) followed by the top `n`
+//! queries.
+void followTopN(FollowTSVReader& input, std::ostream& output, const ScanOptions& scan, unsigned int n, std::chrono::seconds interval);
+
+//! Print the top `n` queries of each `window` seconds long window of a
+//! time-sorted stream, windows starting every `step` seconds.
+//!
+//! The stream is read once: rows are added to the ranker as they enter the
+//! window, and removed from it when they leave it. Each window is printed as
+//! a `# START END` line (inclusive timestamps) followed by its top `n`
+//! queries. Windows start at `--from` (or the epoch) plus multiples of
+//! `step`, those without any row being skipped.
+void printWindowedTopN(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, unsigned int n,
+                       Timestamp::Value window, Timestamp::Value step);
+
+//! Print the top `n` queries of each window of a time-sorted in-memory
+//! buffer (see above), the range being located by bisection.
+void printWindowedTopN(std::string_view input, std::ostream& output, const ScanOptions& scan, unsigned int n,
+                       Timestamp::Value window, Timestamp::Value step);
+
+//! Print the number of distinct queries of a stream.
+//!
+//! Streams can't be split, so they are always read by a single thread.
+void printDistinctCount(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan);
+
+//! Print the number of distinct queries of in-memory buffers, split between
+//! threads.
+void printDistinctCount(const std::vector<std::string_view>& inputs, std::ostream& output, const ScanOptions& scan);
+
+//! Print the number of distinct queries of an index.
+void printDistinctCount(const Index& index, std::ostream& output, const ScanOptions& scan);
+
+//! Write the index of the rows of an in-memory buffer, read from the given
+//! version of its input file.
+//!
+//! @return An error message if the index couldn't be written.
+std::optional<std::string> writeIndex(std::string_view input, const Index::Source& source, const std::string& path);
+
+//! Build the index of the rows of an in-memory buffer, in memory.
+//!
+//! @return The index, or none if the rows have too many distinct queries.
+std::optional<Index> buildIndex(std::string_view input);
+
+//! Build the index of the rows of a stream, in memory.
+//!
+//! @return The index, or none if the rows have too many distinct queries.
+std::optional<Index> buildIndex(PipelinedTSVReader& input);
+
+//! Print an estimation of the top `n` queries of a stream, tracking at most
+//! `capacity` queries.
+void printApproxTopN(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, unsigned int n, unsigned int capacity);
+
+//! Print an estimation of the top `n` queries of in-memory buffers, split
+//! between threads (each thread filling its own summary).
+void printApproxTopN(const std::vector<std::string_view>& inputs, std::ostream& output, const ScanOptions& scan, unsigned int n, unsigned int capacity);
+
+//! Print an estimation of the number of distinct queries of a stream.
+void printApproxDistinctCount(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, unsigned int precision);
+
+//! Print an estimation of the number of distinct queries of in-memory
+//! buffers, split between threads (each thread filling its own sketch).
+void printApproxDistinctCount(const std::vector<std::string_view>& inputs, std::ostream& output, const ScanOptions& scan, unsigned int precision);
+
+//! Print the top `n` queries of a stream, counting them within
+//! `memory_limit` bytes (see `SpillingCounter`), only the `n` best candidates
+//! being kept in memory while ranking.
+//!
+//! @return false if the counts couldn't be spilled to temporary files.
+bool printBoundedTopN(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, unsigned int n, std::size_t memory_limit);
+
+//! Print the top `n` queries of in-memory buffers, split between threads
+//! (each thread counting within its share of `memory_limit` bytes).
+//!
+//! @return false if the counts couldn't be spilled to temporary files.
+bool printBoundedTopN(const std::vector<std::string_view>& inputs, std::ostream& output, const ScanOptions& scan, unsigned int n, std::size_t memory_limit);
+
+//! Print the number of distinct queries of a stream, counting them within
+//! `memory_limit` bytes.
+//!
+//! @return false if the counts couldn't be spilled to temporary files.
+bool printBoundedDistinctCount(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, std::size_t memory_limit);
+
+//! Print the number of distinct queries of in-memory buffers, split between
+//! threads (each thread counting within its share of `memory_limit` bytes).
+//!
+//! @return false if the counts couldn't be spilled to temporary files.
+bool printBoundedDistinctCount(const std::vector<std::string_view>& inputs, std::ostream& output, const ScanOptions& scan, std::size_t memory_limit);
+
+//! Print the number of queries and of distinct queries of each `width`
+//! seconds long bucket of a stream (see `Histogram`), in a single pass.
+//!
+//! Buckets start at `--from` (or the epoch) plus multiples of `width`. Each
+//! one is printed as a `START TOTAL DISTINCT` line, from the first bucket
+//! with a row to the last one.
+void printHistogram(PipelinedTSVReader& input, std::ostream& output, const ScanOptions& scan, Timestamp::Value width);
+
+//! Print the histogram of in-memory buffers (see above), split between
+//! threads (each thread counting its chunk in its own histogram).
+void printHistogram(const std::vector<std::string_view>& inputs, std::ostream& output, const ScanOptions& scan, Timestamp::Value width);
+
+//! Write the counts of the queries of a stream as a partial aggregate (see
+//! `Partial`), counting them within `memory_limit` bytes.
+//!
+//! @return false if the partial aggregate couldn't be written.
+bool writePartial(PipelinedTSVReader& input, const std::string& path, const ScanOptions& scan, std::size_t memory_limit);
+
+//! Write the counts of the queries of in-memory buffers as a partial
+//! aggregate, split between threads (as `printBoundedTopN()`).
+//!
+//! @return false if the partial aggregate couldn't be written.
+bool writePartial(const std::vector<std::string_view>& inputs, const std::string& path, const ScanOptions& scan, std::size_t memory_limit);
+
+//! Write a distinct sketch of the queries of a stream as a partial aggregate.
+//!
+//! @return false if the partial aggregate couldn't be written.
+bool writeApproxPartial(PipelinedTSVReader& input, const std::string& path, const ScanOptions& scan, unsigned int precision);
+
+//! Write a distinct sketch of the queries of in-memory buffers as a partial
+//! aggregate, split between threads (each thread filling its own sketch).
+//!
+//! @return false if the partial aggregate couldn't be written.
+bool writeApproxPartial(const std::vector<std::string_view>& inputs, const std::string& path, const ScanOptions& scan, unsigned int precision);
+
+//! Print the top `n` queries of partial aggregates with counts, summing their
+//! counts within `memory_limit` bytes.
+//!
+//! @return false if the counts couldn't be spilled to temporary files.
+bool printMergedTopN(const std::vector<Partial>& partials, std::ostream& output, unsigned int n, std::size_t memory_limit);
+
+//! Print the number of distinct queries of partial aggregates: exactly if
+//! they all have counts, else estimated by merging their sketches (of the
+//! same precision), the queries of those with counts being added to it.
+//!
+//! @return false if the counts couldn't be spilled to temporary files.
+bool printMergedDistinctCount(const std::vector<Partial>& partials, std::ostream& output, std::size_t memory_limit);
+
+//! Parse the `--from` and `--to` options into the range of a scan.
+//!
+//! @return An error message if a timestamp is invalid or the range is empty.
+std::optional<std::string> parseTimestampRange(const Arguments& arguments, ScanOptions& scan);
@@ -0,0 +1,150 @@
+#include "delimiters.h"
+
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const std::size_t BlockSize = 64;
+
+const std::size_t NoBlock = std::numeric_limits<std::size_t>::max();
+
+std::uint64_t scalarMask(const char* block)
+{
+    std::uint64_t mask = 0;
+    for (std::size_t i = 0; i < BlockSize; i++) {
+        if (block[i] == '\t' || block[i] == '\n')
+            mask |= std::uint64_t(1) << i;
+    }
+    return mask;
+}
+
+#if defined(__x86_64__)
+
+std::uint64_t sse2Mask(const char* block)
+{
+    const __m128i tabs = _mm_set1_epi8('\t');
+    const __m128i newlines = _mm_set1_epi8('\n');
+
+    std::uint64_t mask = 0;
+    for (std::size_t i = 0; i < BlockSize; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        __m128i delimiters = _mm_or_si128(_mm_cmpeq_epi8(bytes, tabs), _mm_cmpeq_epi8(bytes, newlines));
+        mask |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(delimiters))) << i;
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+std::uint64_t avx2Mask(const char* block)
+{
+    const __m256i tabs = _mm256_set1_epi8('\t');
+    const __m256i newlines = _mm256_set1_epi8('\n');
+
+    __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    __m256i low_delimiters = _mm256_or_si256(_mm256_cmpeq_epi8(low, tabs), _mm256_cmpeq_epi8(low, newlines));
+    __m256i high_delimiters = _mm256_or_si256(_mm256_cmpeq_epi8(high, tabs), _mm256_cmpeq_epi8(high, newlines));
+
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(low_delimiters))
+        | static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(high_delimiters))) << 32;
+}
+
+#endif
+
+} // namespace
+
+DelimiterKernel bestDelimiterKernel()
+{
+    static const DelimiterKernel best = isSupported(DelimiterKernel::Avx2) ? DelimiterKernel::Avx2
+        : isSupported(DelimiterKernel::Sse2) ? DelimiterKernel::Sse2
+        : DelimiterKernel::Scalar;
+    return best;
+}
+
+bool isSupported(DelimiterKernel kernel)
+{
+    switch (kernel) {
+#if defined(__x86_64__)
+        case DelimiterKernel::Avx2:
+            return __builtin_cpu_supports("avx2");
+
+        case DelimiterKernel::Sse2:
+            return true;
+#endif
+
+        case DelimiterKernel::Scalar:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+const char* nameOf(DelimiterKernel kernel)
+{
+    switch (kernel) {
+        case DelimiterKernel::Scalar:
+            return "scalar";
+
+        case DelimiterKernel::Sse2:
+            return "sse2";
+
+        case DelimiterKernel::Avx2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+DelimiterScanner::DelimiterScanner(std::string_view data, DelimiterKernel kernel):
+    data_(data),
+    kernel_(scalarMask),
+    block_(NoBlock),
+    mask_(0)
+{
+#if defined(__x86_64__)
+    if (kernel == DelimiterKernel::Avx2 && isSupported(kernel)) {
+        kernel_ = avx2Mask;
+    } else if (kernel != DelimiterKernel::Scalar) {
+        kernel_ = sse2Mask;
+    }
+#endif
+}
+
+std::uint64_t DelimiterScanner::maskOf(std::size_t block) const
+{
+    if (block + BlockSize <= data_.size())
+        return kernel_(data_.data() + block);
+
+    // the last block is padded, so that the kernels never read past the buffer
+    char padded[BlockSize] = {};
+    std::memcpy(padded, data_.data() + block, data_.size() - block);
+    return kernel_(padded);
+}
+
+std::size_t DelimiterScanner::next(std::size_t pos)
+{
+    for (; pos < data_.size(); pos = pos - pos % BlockSize + BlockSize) {
+        std::size_t block = pos - pos % BlockSize;
+        if (block != block_) {
+            block_ = block;
+            mask_ = maskOf(block);
+        }
+
+        std::uint64_t mask = mask_ & (~std::uint64_t(0) << (pos % BlockSize));
+        if (mask != 0)
+            return block + __builtin_ctzll(mask);
+    }
+    return data_.size();
+}
+
+std::size_t DelimiterScanner::nextNewline(std::size_t pos)
+{
+    for (pos = next(pos); pos < data_.size() && data_[pos] != '\n'; pos = next(pos + 1))
+        ;
+    return pos;
+}
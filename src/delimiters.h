@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <tuple>
+
+#include "row.h"
+
+//! Implementation of the search for delimiters in a block of 64 bytes.
+enum class DelimiterKernel
+{
+    Scalar, //!< One byte at a time.
+    Sse2,   //!< 16 bytes at a time (x86-64).
+    Avx2,   //!< 32 bytes at a time (x86-64, detected at runtime).
+};
+
+//! Fastest kernel supported by the CPU.
+DelimiterKernel bestDelimiterKernel();
+
+//! Whether the CPU supports a kernel.
+bool isSupported(DelimiterKernel kernel);
+
+//! Name of a kernel, e.g. for benchmarks.
+const char* nameOf(DelimiterKernel kernel);
+
+//! Finds the delimiters (tabs and newlines) of a buffer.
+//!
+//! The buffer is processed in blocks of 64 bytes, the kernel comparing all
+//! the bytes of a block at once into a 64 bit mask of its delimiters, which
+//! are then iterated with bit tricks. Parsing a line thus takes a single
+//! vectorized pass over its bytes, instead of one pass for the newline then
+//! one per field for the tabs.
+class DelimiterScanner
+{
+public:
+    explicit DelimiterScanner(std::string_view data = std::string_view(),
+                              DelimiterKernel kernel = bestDelimiterKernel());
+
+    //! Position of the first delimiter at or after `pos`, or the size of the
+    //! buffer if there is none.
+    std::size_t next(std::size_t pos);
+
+    //! Position of the first newline at or after `pos`, or the size of the
+    //! buffer if there is none.
+    std::size_t nextNewline(std::size_t pos);
+
+    //! Parse the line starting at `pos` into a row of tab separated columns
+    //! (string fields being views into the buffer), moving `pos` past its
+    //! newline.
+    //!
+    //! @return false if the line doesn't end with a newline, the line then
+    //!         going up to the end of the buffer (and `pos` being its size).
+    template <typename... Fields>
+    bool parseLine(std::size_t& pos, Row<Fields...>& row)
+    {
+        row.status = RowStatus::Valid;
+
+        // parse each column as soon as it is delimited, until the end of the
+        // line
+        std::size_t columns = 0;
+        std::size_t delimiter = pos;
+        bool tab = true;
+        auto parseColumn = [&](auto& field) {
+            if (!tab)
+                return;
+
+            delimiter = next(pos);
+            std::string_view column = data_.substr(pos, delimiter - pos);
+            if (row.status == RowStatus::Valid && !parseField(column, field)) {
+                row.status = RowStatus::InvalidField;
+                row.invalidColumn = column;
+            }
+
+            columns++;
+            tab = delimiter != data_.size() && data_[delimiter] == '\t';
+            pos = delimiter + 1;
+        };
+        std::apply([&](auto&... fields) { (parseColumn(fields), ...); }, row.fields);
+
+        // skip the extra columns
+        if (tab) {
+            columns++;
+            delimiter = nextNewline(pos);
+        }
+
+        if (columns != Row<Fields...>::ColumnCount)
+            row.status = RowStatus::WrongColumnCount;
+
+        if (delimiter == data_.size()) {
+            pos = delimiter;
+            return false;
+        }
+        pos = delimiter + 1;
+        return true;
+    }
+
+private:
+    typedef std::uint64_t (*Kernel)(const char* block);
+
+    //! Mask of the delimiters of the block starting at `block`.
+    std::uint64_t maskOf(std::size_t block) const;
+
+    std::string_view data_;
+    Kernel kernel_;
+
+    // mask of the delimiters of the current block
+    std::size_t block_;
+    std::uint64_t mask_;
+};
+
+//! Parse a single line (without its newline) into a row.
+template <typename... Fields>
+void parseRow(std::string_view line, Row<Fields...>& row)
+{
+    DelimiterScanner scanner(line);
+    std::size_t pos = 0;
+    scanner.parseLine(pos, row);
+}
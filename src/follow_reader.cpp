@@ -0,0 +1,105 @@
+#include "follow_reader.h"
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "delimiters.h"
+#include "stats.h"
+
+FollowTSVReader::FollowTSVReader(std::string path, std::size_t bufferSize):
+    path_(std::move(path)),
+    fd_(-1),
+    offset_(0),
+    buffer_(bufferSize),
+    begin_(0),
+    end_(0)
+{
+}
+
+FollowTSVReader::~FollowTSVReader()
+{
+    if (fd_ != -1)
+        close(fd_);
+}
+
+bool FollowTSVReader::open()
+{
+    int fd = ::open(path_.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    if (fd_ != -1)
+        close(fd_);
+    fd_ = fd;
+    offset_ = 0;
+    begin_ = end_ = 0;
+    return true;
+}
+
+bool FollowTSVReader::reopenIfChanged()
+{
+    struct stat opened, current;
+    if (fstat(fd_, &opened) == -1)
+        return false;
+
+    // the path is missing while the file is being rotated, keep reading the
+    // opened one until it appears again
+    if (stat(path_.c_str(), &current) == -1)
+        return false;
+
+    if (current.st_dev != opened.st_dev || current.st_ino != opened.st_ino)
+        return open();
+
+    if (static_cast<std::size_t>(opened.st_size) < offset_) {
+        if (lseek(fd_, 0, SEEK_SET) == -1)
+            return false;
+        offset_ = 0;
+        begin_ = end_ = 0;
+        return true;
+    }
+
+    return false;
+}
+
+bool FollowTSVReader::readNextRow(LogRow& row)
+{
+    if (fd_ == -1)
+        return false;
+
+    for (;;) {
+        const char* begin = buffer_.data() + begin_;
+        auto newline = static_cast<const char*>(std::memchr(begin, '\n', end_ - begin_));
+        if (newline) {
+            parseRow(std::string_view(begin, newline - begin), row);
+            begin_ = newline - buffer_.data() + 1;
+            return true;
+        }
+
+        // keep the start of the partial line, growing the buffer for lines
+        // longer than it
+        std::memmove(buffer_.data(), begin, end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+        if (end_ == buffer_.size())
+            buffer_.resize(2 * buffer_.size());
+
+        ssize_t n = read(fd_, buffer_.data() + end_, buffer_.size() - end_);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n > 0) {
+            end_ += n;
+            offset_ += n;
+            Stats::global().add(Stats::Counter::BytesRead, n);
+            continue;
+        }
+
+        // caught up with the writer, unless the file changed
+        if (!reopenIfChanged())
+            return false;
+    }
+}
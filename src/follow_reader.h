@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "row.h"
+
+//! Row reader following a growing file, like `tail -F`.
+//!
+//! Rows are read until the end of the file currently written, after which
+//! `readNextRow()` returns false, resuming with the rows appended since on
+//! its next call. A partial last line is kept until its newline is written.
+//! If the file is truncated it is read again from its start, and if it is
+//! replaced (e.g. rotated), the new file is read from its start.
+//!
+//! Views are invalidated by the next call to `readNextRow()`.
+class FollowTSVReader
+{
+public:
+    static const std::size_t DefaultBufferSize = 1 << 20;
+
+    explicit FollowTSVReader(std::string path, std::size_t bufferSize = DefaultBufferSize);
+
+    FollowTSVReader(const FollowTSVReader&) = delete;
+    FollowTSVReader& operator=(const FollowTSVReader&) = delete;
+
+    ~FollowTSVReader();
+
+    //! Open the followed file.
+    //!
+    //! @return false if the file couldn't be opened.
+    bool open();
+
+    bool readNextRow(LogRow& row);
+
+private:
+    //! Reopen the file if it was truncated or replaced since opened.
+    //!
+    //! @return false if the file is unchanged (or couldn't be reopened).
+    bool reopenIfChanged();
+
+    std::string path_;
+    int fd_;
+
+    // bytes of the file read so far, to detect truncations
+    std::size_t offset_;
+
+    // read but unparsed bytes are in [begin_, end_)
+    std::vector<char> buffer_;
+    std::size_t begin_;
+    std::size_t end_;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+//! Version of `hashString()`, written into the files which depend on its
+//! values (see `Partial`). It must change whenever the hash does.
+const std::uint32_t HashVersion = 1;
+
+//! Load `n` (at most 8) bytes as an integer.
+inline std::uint64_t hashLoad(const char* bytes, std::size_t n)
+{
+    std::uint64_t word = 0;
+    std::memcpy(&word, bytes, n);
+    return word;
+}
+
+//! Fold the 128 bits product of two integers.
+inline std::uint64_t hashMix(std::uint64_t a, std::uint64_t b)
+{
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+}
+
+//! Hash a string on 64 bits, with all bits well mixed.
+//!
+//! Strings are hashed 16 bytes at a time, with a single multiplication each
+//! (in the style of wyhash). Short strings are read with two overlapping
+//! loads, so that hashing them doesn't branch on each byte. Unlike
+//! `std::hash`, the values don't depend on the standard library, so that
+//! sketches written by different builds can be merged.
+inline std::uint64_t hashString(std::string_view str)
+{
+    const std::uint64_t Secret0 = 0xa0761d6478bd642f;
+    const std::uint64_t Secret1 = 0xe7037ed1a0b428db;
+
+    const char* bytes = str.data();
+    std::size_t n = str.size();
+    std::uint64_t seed = Secret0;
+    std::uint64_t a = 0;
+    std::uint64_t b = 0;
+    if (n > 16) {
+        for (; n > 16; bytes += 16, n -= 16)
+            seed = hashMix(hashLoad(bytes, 8) ^ Secret1, hashLoad(bytes + 8, 8) ^ seed);
+        a = hashLoad(bytes + n - 16, 8);
+        b = hashLoad(bytes + n - 8, 8);
+    } else if (n >= 8) {
+        a = hashLoad(bytes, 8);
+        b = hashLoad(bytes + n - 8, 8);
+    } else if (n >= 4) {
+        a = hashLoad(bytes, 4);
+        b = hashLoad(bytes + n - 4, 4);
+    } else if (n > 0) {
+        a = static_cast<std::uint64_t>(static_cast<unsigned char>(bytes[0])) << 16
+            | static_cast<std::uint64_t>(static_cast<unsigned char>(bytes[n / 2])) << 8
+            | static_cast<unsigned char>(bytes[n - 1]);
+    }
+
+    return hashMix(Secret1 ^ str.size(), hashMix(a ^ Secret1, b ^ seed));
+}
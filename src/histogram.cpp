@@ -0,0 +1,118 @@
+#include "histogram.h"
+
+#include <limits>
+#include <utility>
+
+namespace {
+
+const std::size_t InitialSeenSlots = 1 << 10;
+
+// no pair has the id of an empty interner slot
+const std::uint64_t EmptyKey = std::numeric_limits<std::uint64_t>::max();
+
+std::uint64_t keyOf(std::uint64_t number, StringInterner::Id id)
+{
+    return number << 32 | id;
+}
+
+std::size_t hash(std::uint64_t key)
+{
+    key *= 0x9e3779b97f4a7c15;
+    return key ^ key >> 32;
+}
+
+} // namespace
+
+Histogram::Histogram(Timestamp::Value origin, Timestamp::Value width, StringInterner::Storage storage):
+    origin_(origin),
+    width_(width),
+    lastPage_(0),
+    lastBuckets_(nullptr),
+    queries_(storage),
+    seen_(InitialSeenSlots, EmptyKey),
+    seenCount_(0)
+{
+}
+
+bool Histogram::add(const Timestamp& timestamp, std::string_view query)
+{
+    if (timestamp.value() < origin_)
+        return false;
+
+    // keys only have 32 bits for the bucket number
+    std::uint64_t number = (timestamp.value() - origin_) / width_;
+    if (number >= std::numeric_limits<std::uint32_t>::max())
+        return false;
+
+    count(number, queries_.intern(query), 1);
+    return true;
+}
+
+void Histogram::merge(const Histogram& other)
+{
+    // the totals are summed, the distinct counts follow from the pairs
+    for (const auto& [page, buckets] : other.pages_) {
+        for (std::size_t i = 0; i < buckets.size(); i++) {
+            if (buckets[i].total != 0)
+                bucket(page * PageBuckets + i).total += buckets[i].total;
+        }
+    }
+
+    for (std::uint64_t key : other.seen_) {
+        if (key != EmptyKey) {
+            StringInterner::Id id = queries_.intern(other.queries_.get(static_cast<StringInterner::Id>(key)));
+            count(key >> 32, id, 0);
+        }
+    }
+}
+
+void Histogram::count(std::uint64_t number, StringInterner::Id id, std::uint64_t occurrences)
+{
+    Bucket& number_bucket = bucket(number);
+    number_bucket.total += occurrences;
+
+    std::uint64_t key = keyOf(number, id);
+    std::size_t mask = seen_.size() - 1;
+    std::size_t slot = hash(key) & mask;
+    while (seen_[slot] != EmptyKey) {
+        if (seen_[slot] == key)
+            return;
+        slot = (slot + 1) & mask;
+    }
+
+    seen_[slot] = key;
+    number_bucket.distinct++;
+
+    // keep the load factor under 1/2, so that probe sequences stay short
+    if (++seenCount_ * 2 > seen_.size())
+        growSeen();
+}
+
+Histogram::Bucket& Histogram::bucket(std::uint64_t number)
+{
+    std::uint64_t page = number / PageBuckets;
+    if (!lastBuckets_ || page != lastPage_) {
+        auto [page_it, inserted] = pages_.try_emplace(page);
+        if (inserted)
+            page_it->second.resize(PageBuckets, Bucket{ 0, 0 });
+        lastPage_ = page;
+        lastBuckets_ = &page_it->second;
+    }
+    return (*lastBuckets_)[number % PageBuckets];
+}
+
+void Histogram::growSeen()
+{
+    std::vector<std::uint64_t> seen(seen_.size() * 2, EmptyKey);
+    std::size_t mask = seen.size() - 1;
+    for (std::uint64_t key : seen_) {
+        if (key == EmptyKey)
+            continue;
+
+        std::size_t slot = hash(key) & mask;
+        while (seen[slot] != EmptyKey)
+            slot = (slot + 1) & mask;
+        seen[slot] = key;
+    }
+    seen_ = std::move(seen);
+}
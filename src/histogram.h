@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "interner.h"
+#include "timestamp.h"
+
+//! Counts the queries and distinct queries of each time bucket.
+//!
+//! Buckets are `width` seconds long, starting at `origin` plus multiples of
+//! `width`. Their counts are kept in flat pages of `PageBuckets` consecutive
+//! buckets, only allocated for the buckets of the rows added, so that rows
+//! far from the others (e.g. a stray timestamp) only cost a page, whatever
+//! the order of the rows. Distinct queries are counted as their (bucket,
+//! query id) pairs are first added, the pairs being kept in an open
+//! addressing set of 64 bit keys (linear probing).
+class Histogram
+{
+public:
+    //! Number of consecutive buckets allocated together.
+    static const std::size_t PageBuckets = std::size_t(1) << 12;
+
+    //! Maximum number of consecutive empty buckets visited between buckets
+    //! with rows, so that a stray timestamp doesn't make the histogram visit
+    //! an arbitrarily large number of empty buckets.
+    static const std::uint64_t MaxGap = std::uint64_t(1) << 24;
+
+    //! @param[in] origin The start of a bucket.
+    //! @param[in] width The length of the buckets, in seconds.
+    //! @param[in] storage How added queries are stored (see `StringInterner`).
+    Histogram(Timestamp::Value origin, Timestamp::Value width, StringInterner::Storage storage = StringInterner::Storage::Copy);
+
+    Histogram(Histogram&&) = default;
+    Histogram& operator=(Histogram&&) = default;
+
+    //! Add a row, at or after the origin.
+    //!
+    //! @return false (the row being ignored) if the row is more than 2^32
+    //!         buckets after the origin.
+    bool add(const Timestamp& timestamp, std::string_view query);
+
+    //! Add the rows of another histogram, with the same buckets.
+    void merge(const Histogram& other);
+
+    //! Call `f(start, total, distinct)` for each bucket, by increasing start,
+    //! from the first bucket with a row to the last one. Empty buckets
+    //! between buckets with rows are visited with zero counts, unless there
+    //! are more than `MaxGap` of them in a row.
+    template <typename F>
+    void visit(F f) const
+    {
+        std::optional<std::uint64_t> previous;
+        for (const auto& [page, buckets] : pages_) {
+            for (std::size_t i = 0; i < buckets.size(); i++) {
+                if (buckets[i].total == 0)
+                    continue;
+
+                std::uint64_t number = page * PageBuckets + i;
+                if (previous && number - *previous - 1 <= MaxGap) {
+                    for (std::uint64_t empty = *previous + 1; empty < number; empty++)
+                        f(origin_ + empty * width_, std::uint64_t(0), std::uint64_t(0));
+                }
+                f(origin_ + number * width_, buckets[i].total, buckets[i].distinct);
+                previous = number;
+            }
+        }
+    }
+
+private:
+    struct Bucket
+    {
+        std::uint64_t total;
+        std::uint64_t distinct;
+    };
+
+    //! Count occurrences of a query (interned in this histogram) in the
+    //! bucket of the given number.
+    void count(std::uint64_t number, StringInterner::Id id, std::uint64_t occurrences);
+
+    //! The bucket of the given number, allocating its page if needed.
+    Bucket& bucket(std::uint64_t number);
+
+    void growSeen();
+
+    Timestamp::Value origin_;
+    Timestamp::Value width_;
+
+    // pages_[p][i] is the bucket of number p * PageBuckets + i
+    std::map<std::uint64_t, std::vector<Bucket>> pages_;
+
+    // last page accessed (none if null), rows being mostly added in order
+    std::uint64_t lastPage_;
+    std::vector<Bucket>* lastBuckets_;
+
+    StringInterner queries_;
+
+    // (bucket number, query id) pairs already counted, as `number << 32 | id`
+    std::vector<std::uint64_t> seen_;
+    std::size_t seenCount_;
+};
@@ -0,0 +1,82 @@
+#include "hyperloglog.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "hash.h"
+
+namespace {
+
+double alpha(std::size_t m)
+{
+    switch (m) {
+        case 16:
+            return 0.673;
+        case 32:
+            return 0.697;
+        case 64:
+            return 0.709;
+        default:
+            return 0.7213 / (1.0 + 1.079 / m);
+    }
+}
+
+} // namespace
+
+HyperLogLog::HyperLogLog(unsigned int precision):
+    precision_(precision),
+    registers_(std::size_t(1) << precision, 0)
+{
+    assert(precision >= MinPrecision && precision <= MaxPrecision);
+}
+
+HyperLogLog::HyperLogLog(unsigned int precision, const std::uint8_t* registers):
+    precision_(precision),
+    registers_(registers, registers + (std::size_t(1) << precision))
+{
+    assert(precision >= MinPrecision && precision <= MaxPrecision);
+}
+
+void HyperLogLog::add(std::string_view str)
+{
+    std::uint64_t h = hashString(str);
+
+    // the first bits select the register, which keeps the highest position of
+    // the first set bit among the remaining ones
+    std::size_t index = h >> (64 - precision_);
+    std::uint64_t remaining = h << precision_;
+    std::uint8_t rank = remaining == 0
+        ? static_cast<std::uint8_t>(64 - precision_ + 1)
+        : static_cast<std::uint8_t>(__builtin_clzll(remaining) + 1);
+
+    registers_[index] = std::max(registers_[index], rank);
+}
+
+void HyperLogLog::merge(const HyperLogLog& other)
+{
+    assert(precision_ == other.precision_);
+    for (std::size_t i = 0; i < registers_.size(); i++)
+        registers_[i] = std::max(registers_[i], other.registers_[i]);
+}
+
+double HyperLogLog::estimate() const
+{
+    double m = static_cast<double>(registers_.size());
+
+    double sum = 0;
+    std::size_t zeros = 0;
+    for (std::uint8_t rank : registers_) {
+        sum += std::ldexp(1.0, -rank);
+        if (rank == 0)
+            zeros++;
+    }
+
+    double estimate = alpha(registers_.size()) * m * m / sum;
+
+    // small cardinalities: linear counting on empty registers is more accurate
+    if (estimate <= 2.5 * m && zeros > 0)
+        estimate = m * std::log(m / zeros);
+
+    return estimate;
+}
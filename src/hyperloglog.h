@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+//! HyperLogLog sketch, estimating the number of distinct strings added.
+//!
+//! Uses `2^precision` one byte registers, whatever the number of strings
+//! added, for a standard error of about `1.04 / sqrt(2^precision)` (0.8% with
+//! the default precision, using 16 KiB).
+//!
+//! Sketches of the same precision can be merged, the result estimating the
+//! number of distinct strings added to either of them.
+class HyperLogLog
+{
+public:
+    static const unsigned int MinPrecision = 4;
+    static const unsigned int MaxPrecision = 18;
+    static const unsigned int DefaultPrecision = 14;
+
+    //! Construct an empty sketch.
+    //!
+    //! @param[in] precision The number of hash bits selecting a register, in
+    //!            [MinPrecision, MaxPrecision].
+    explicit HyperLogLog(unsigned int precision = DefaultPrecision);
+
+    //! Construct a sketch from the registers of a saved one (see
+    //! `registers()`).
+    //!
+    //! @param[in] registers The `2^precision` registers of the sketch.
+    HyperLogLog(unsigned int precision, const std::uint8_t* registers);
+
+    //! Add a string to the sketch.
+    void add(std::string_view str);
+
+    //! Merge another sketch (of the same precision) into this one.
+    void merge(const HyperLogLog& other);
+
+    //! Estimate the number of distinct strings added.
+    double estimate() const;
+
+    inline unsigned int precision() const
+    { return precision_; }
+
+    //! Registers of the sketch, e.g. to save it.
+    inline const std::vector<std::uint8_t>& registers() const
+    { return registers_; }
+
+private:
+    unsigned int precision_;
+    std::vector<std::uint8_t> registers_;
+};
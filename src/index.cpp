@@ -0,0 +1,416 @@
+#include "index.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+
+#include <sys/stat.h>
+
+#include "stats.h"
+
+namespace {
+
+const char Magic[8] = { 'H', 'N', 'S', 'T', 'I', 'D', 'X', '4' };
+
+struct Header
+{
+    char magic[8];
+    std::uint64_t inputSize;
+    std::int64_t inputMtimeSeconds;
+    std::int64_t inputMtimeNanoseconds;
+    std::uint64_t rowCount;
+    std::uint64_t queryCount;
+    std::uint64_t queryBytes;
+    std::uint64_t bucketOrigin;
+    std::uint64_t bucketWidth;
+    std::uint64_t bucketCount;
+    std::uint64_t fanout;
+    std::uint64_t countCount;
+};
+
+std::size_t padded(std::size_t size)
+{
+    return (size + 7) & ~std::size_t(7);
+}
+
+//! Number of nodes of each level of an aggregation tree, from its buckets to
+//! its root.
+std::vector<std::size_t> levelSizesOf(std::size_t bucket_count)
+{
+    std::vector<std::size_t> sizes;
+    if (bucket_count == 0)
+        return sizes;
+
+    sizes.push_back(bucket_count);
+    while (sizes.back() > 1)
+        sizes.push_back((sizes.back() + Index::Fanout - 1) / Index::Fanout);
+    return sizes;
+}
+
+std::size_t sizeOf(const Header& header)
+{
+    std::size_t node_count = 0;
+    for (std::size_t size : levelSizesOf(header.bucketCount))
+        node_count += size;
+
+    return sizeof(Header)
+        + sizeof(std::uint64_t) * (header.queryCount + 1)
+        + padded(header.queryBytes)
+        + sizeof(Timestamp::Value) * header.rowCount
+        + padded(sizeof(Index::QueryId) * header.rowCount)
+        + sizeof(std::uint64_t) * (node_count + 1)
+        + sizeof(Index::QueryCount) * header.countCount
+        + sizeof(std::uint64_t) * WaveletMatrix::wordCount(header.rowCount, WaveletMatrix::bitsFor(header.rowCount));
+}
+
+} // namespace
+
+bool Index::Builder::add(const Timestamp& timestamp, std::string_view query)
+{
+    QueryId id = queries_.intern(query);
+    if (queries_.size() > std::numeric_limits<QueryId>::max())
+        return false;
+
+    rows_.emplace_back(timestamp.value(), id);
+    return true;
+}
+
+std::size_t Index::Builder::serialize(std::vector<std::uint64_t>& words)
+{
+    // the input isn't necessarily sorted, the index is
+    std::stable_sort(rows_.begin(), rows_.end(),
+                     [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+    Header header;
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.inputSize = source_.size;
+    header.inputMtimeSeconds = source_.mtimeSeconds;
+    header.inputMtimeNanoseconds = source_.mtimeNanoseconds;
+    header.rowCount = rows_.size();
+    header.queryCount = queries_.size();
+    header.queryBytes = 0;
+    for (QueryId id = 0; id < queries_.size(); id++)
+        header.queryBytes += queries_.get(id).size();
+
+    header.bucketOrigin = rows_.empty() ? 0 : rows_.front().first;
+    header.bucketWidth = MinBucketWidth;
+    header.bucketCount = 0;
+    if (!rows_.empty()) {
+        Timestamp::Value span = rows_.back().first - header.bucketOrigin;
+        while (span / header.bucketWidth >= rows_.size() && header.bucketWidth <= span / 2)
+            header.bucketWidth *= 2;
+        header.bucketCount = span / header.bucketWidth + 1;
+    }
+    header.fanout = Fanout;
+
+    // count the queries of each bucket, then of each node from the counts of
+    // its children (the nodes of a level being stored after their children)
+    std::vector<std::size_t> level_sizes = levelSizesOf(header.bucketCount);
+    std::vector<std::uint64_t> node_offsets(1, 0);
+    std::vector<QueryCount> node_counts;
+
+    std::vector<std::uint32_t> counts(queries_.size(), 0);
+    std::vector<QueryId> ids;
+    auto add = [&](QueryId id, std::uint32_t count) {
+        if (counts[id] == 0)
+            ids.push_back(id);
+        counts[id] += count;
+    };
+    auto endNode = [&] {
+        for (QueryId id : ids) {
+            node_counts.push_back({ id, counts[id] });
+            counts[id] = 0;
+        }
+        ids.clear();
+        node_offsets.push_back(node_counts.size());
+    };
+
+    std::size_t row = 0;
+    for (std::size_t bucket = 0; bucket < header.bucketCount; bucket++) {
+        for (; row < rows_.size() && (rows_[row].first - header.bucketOrigin) / header.bucketWidth == bucket; row++)
+            add(rows_[row].second, 1);
+        endNode();
+    }
+
+    std::size_t children = 0;
+    for (std::size_t level = 1; level < level_sizes.size(); level++) {
+        for (std::size_t node = 0; node < level_sizes[level]; node++) {
+            std::size_t first = children + node * Fanout;
+            std::size_t last = children + std::min((node + 1) * Fanout, level_sizes[level - 1]);
+            for (std::uint64_t i = node_offsets[first]; i < node_offsets[last]; i++)
+                add(node_counts[i].id, node_counts[i].count);
+            endNode();
+        }
+        children += level_sizes[level - 1];
+    }
+    header.countCount = node_counts.size();
+
+    // position (plus one, 0 meaning none) of the previous row of each row's
+    // query: the distinct queries of rows [begin, end) are the rows of the
+    // range whose previous occurrence is before `begin`
+    std::vector<std::uint64_t> previous_rows(rows_.size());
+    {
+        std::vector<std::uint64_t> last_rows(queries_.size(), 0);
+        for (std::size_t i = 0; i < rows_.size(); i++) {
+            previous_rows[i] = last_rows[rows_[i].second];
+            last_rows[rows_[i].second] = i + 1;
+        }
+    }
+
+    std::size_t size = sizeOf(header);
+    words.assign(size / sizeof(std::uint64_t), 0);
+
+    char* data = reinterpret_cast<char*>(words.data());
+    std::memcpy(data, &header, sizeof(Header));
+    data += sizeof(Header);
+
+    auto offsets = reinterpret_cast<std::uint64_t*>(data);
+    char* bytes = data + sizeof(std::uint64_t) * (queries_.size() + 1);
+    std::uint64_t offset = 0;
+    for (QueryId id = 0; id < queries_.size(); id++) {
+        std::string_view query = queries_.get(id);
+        offsets[id] = offset;
+        std::memcpy(bytes + offset, query.data(), query.size());
+        offset += query.size();
+    }
+    offsets[queries_.size()] = offset;
+    data = bytes + padded(header.queryBytes);
+
+    auto timestamps = reinterpret_cast<Timestamp::Value*>(data);
+    data += sizeof(Timestamp::Value) * rows_.size();
+    auto query_ids = reinterpret_cast<QueryId*>(data);
+    data += padded(sizeof(QueryId) * rows_.size());
+    for (std::size_t i = 0; i < rows_.size(); i++) {
+        timestamps[i] = rows_[i].first;
+        query_ids[i] = rows_[i].second;
+    }
+
+    std::memcpy(data, node_offsets.data(), sizeof(std::uint64_t) * node_offsets.size());
+    data += sizeof(std::uint64_t) * node_offsets.size();
+    std::memcpy(data, node_counts.data(), sizeof(QueryCount) * node_counts.size());
+    data += sizeof(QueryCount) * node_counts.size();
+
+    WaveletMatrix::build(previous_rows, WaveletMatrix::bitsFor(rows_.size()), reinterpret_cast<std::uint64_t*>(data));
+
+    rows_ = {};
+    queries_ = StringInterner();
+    return size;
+}
+
+Index Index::Builder::build()
+{
+    Index index;
+    std::size_t size = serialize(index.memory_);
+    index.load(std::string_view(reinterpret_cast<const char*>(index.memory_.data()), size));
+    return index;
+}
+
+bool Index::Builder::write(const std::string& path)
+{
+    std::vector<std::uint64_t> words;
+    std::size_t size = serialize(words);
+
+    // write to a temporary file first, so that readers never see a partial index
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream output(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!output)
+            return false;
+
+        output.write(reinterpret_cast<const char*>(words.data()), size);
+        if (!output.flush()) {
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+    }
+
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+std::string Index::pathFor(const std::string& input_filename)
+{
+    return input_filename + ".idx";
+}
+
+std::optional<Index::Source> Index::sourceOf(const std::string& input_filename)
+{
+    struct stat st;
+    if (stat(input_filename.c_str(), &st) == -1 || !S_ISREG(st.st_mode))
+        return std::nullopt;
+
+    return Source{ static_cast<std::uint64_t>(st.st_size), st.st_mtim.tv_sec, st.st_mtim.tv_nsec };
+}
+
+std::optional<Index> Index::openFor(const std::string& input_filename)
+{
+    auto source = sourceOf(input_filename);
+    if (!source)
+        return std::nullopt;
+
+    // an index is only used for the exact version of the input it was built
+    // from (comparing timestamps with the index file would miss changes
+    // within the same second, or an older file moved in place)
+    auto index = open(pathFor(input_filename));
+    if (!index || index->source_ != *source)
+        return std::nullopt;
+    return index;
+}
+
+std::optional<Index> Index::open(const std::string& path)
+{
+    Stats::ScopedPhase phase(Stats::Phase::Open);
+
+    auto file = MappedFile::open(path);
+    if (!file)
+        return std::nullopt;
+
+    Index index;
+    index.file_ = std::move(file);
+    if (!index.load(index.file_->contents()))
+        return std::nullopt;
+    return index;
+}
+
+Index::Index():
+    source_{ 0, 0, 0 },
+    rowCount_(0),
+    queryCount_(0),
+    queryOffsets_(nullptr),
+    queryBytes_(nullptr),
+    timestamps_(nullptr),
+    queryIds_(nullptr),
+    bucketOrigin_(0),
+    bucketWidth_(1),
+    bucketCount_(0),
+    nodeOffsets_(nullptr),
+    nodeCounts_(nullptr)
+{
+}
+
+bool Index::load(std::string_view contents)
+{
+    if (contents.size() < sizeof(Header))
+        return false;
+
+    Header header;
+    std::memcpy(&header, contents.data(), sizeof(Header));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0)
+        return false;
+    if (header.fanout != Fanout || header.bucketWidth == 0)
+        return false;
+    if (contents.size() != sizeOf(header))
+        return false;
+
+    const char* data = contents.data();
+
+    source_ = Source{ header.inputSize, header.inputMtimeSeconds, header.inputMtimeNanoseconds };
+    rowCount_ = header.rowCount;
+    queryCount_ = header.queryCount;
+
+    data += sizeof(Header);
+    queryOffsets_ = reinterpret_cast<const std::uint64_t*>(data);
+    data += sizeof(std::uint64_t) * (header.queryCount + 1);
+    queryBytes_ = data;
+    data += padded(header.queryBytes);
+    timestamps_ = reinterpret_cast<const Timestamp::Value*>(data);
+    data += sizeof(Timestamp::Value) * header.rowCount;
+    queryIds_ = reinterpret_cast<const QueryId*>(data);
+    data += padded(sizeof(QueryId) * header.rowCount);
+
+    bucketOrigin_ = header.bucketOrigin;
+    bucketWidth_ = header.bucketWidth;
+    bucketCount_ = header.bucketCount;
+    levelSizes_ = levelSizesOf(bucketCount_);
+    nodeOffsets_ = reinterpret_cast<const std::uint64_t*>(data);
+    data += sizeof(std::uint64_t) * (std::accumulate(levelSizes_.begin(), levelSizes_.end(), std::size_t(0)) + 1);
+    nodeCounts_ = reinterpret_cast<const QueryCount*>(data);
+    data += sizeof(QueryCount) * header.countCount;
+
+    previousRows_ = WaveletMatrix(reinterpret_cast<const std::uint64_t*>(data), rowCount_, WaveletMatrix::bitsFor(rowCount_));
+
+    return true;
+}
+
+std::size_t Index::queryCount() const
+{
+    return queryCount_;
+}
+
+std::string_view Index::query(QueryId id) const
+{
+    std::uint64_t begin = queryOffsets_[id];
+    std::uint64_t end = queryOffsets_[id + 1];
+    return std::string_view(queryBytes_ + begin, end - begin);
+}
+
+std::pair<const Index::QueryId*, const Index::QueryId*> Index::rowsInRange(const Timestamp& from, const Timestamp& to) const
+{
+    const Timestamp::Value* begin = std::lower_bound(timestamps_, timestamps_ + rowCount_, from.value());
+    const Timestamp::Value* end = std::upper_bound(begin, timestamps_ + rowCount_, to.value());
+    return { queryIds_ + (begin - timestamps_), queryIds_ + (end - timestamps_) };
+}
+
+void Index::decomposeRange(const Timestamp& from, const Timestamp& to,
+                           std::vector<std::pair<const QueryId*, const QueryId*>>& rows,
+                           std::vector<std::pair<const QueryCount*, const QueryCount*>>& nodes) const
+{
+    if (to < from)
+        return;
+
+    // buckets [first, last) are fully within the range
+    Timestamp::Value lo = from.value(), hi = to.value();
+    std::size_t first = 0;
+    if (lo > bucketOrigin_)
+        first = (lo - bucketOrigin_) / bucketWidth_ + ((lo - bucketOrigin_) % bucketWidth_ != 0);
+    std::size_t last = 0;
+    if (hi >= bucketOrigin_)
+        last = (hi - bucketOrigin_) / bucketWidth_ + ((hi - bucketOrigin_) % bucketWidth_ == bucketWidth_ - 1);
+    last = std::min(last, bucketCount_);
+
+    if (first >= last) {
+        rows.push_back(rowsInRange(from, to));
+        return;
+    }
+
+    // rows of the partial buckets (all rows are before the end of the last bucket)
+    if (first > 0)
+        rows.push_back(rowsInRange(from, Timestamp(bucketOrigin_ + first * bucketWidth_ - 1)));
+    if (last < bucketCount_)
+        rows.push_back(rowsInRange(Timestamp(bucketOrigin_ + last * bucketWidth_), to));
+
+    // cover the full buckets with as few nodes as possible: the nodes at the
+    // edges of each level, then their parents one level up
+    std::size_t level_offset = 0;
+    for (std::size_t level = 0; first < last; level++) {
+        std::size_t parent_first = (first + Fanout - 1) / Fanout;
+        std::size_t parent_last = last / Fanout;
+        if (level + 1 == levelSizes_.size() || parent_first >= parent_last) {
+            nodes.emplace_back(nodeCounts_ + nodeOffsets_[level_offset + first],
+                               nodeCounts_ + nodeOffsets_[level_offset + last]);
+            break;
+        }
+
+        nodes.emplace_back(nodeCounts_ + nodeOffsets_[level_offset + first],
+                           nodeCounts_ + nodeOffsets_[level_offset + parent_first * Fanout]);
+        nodes.emplace_back(nodeCounts_ + nodeOffsets_[level_offset + parent_last * Fanout],
+                           nodeCounts_ + nodeOffsets_[level_offset + last]);
+
+        level_offset += levelSizes_[level];
+        first = parent_first;
+        last = parent_last;
+    }
+}
+
+std::size_t Index::distinctInRange(const Timestamp& from, const Timestamp& to) const
+{
+    auto [begin, end] = rowsInRange(from, to);
+    std::size_t begin_row = begin - queryIds_;
+    std::size_t end_row = end - queryIds_;
+
+    // first occurrences within the range, i.e. whose previous row (plus one)
+    // is at most `begin_row`
+    return previousRows_.countLess(begin_row, end_row, begin_row + 1);
+}
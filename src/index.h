@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "interner.h"
+#include "mapped_file.h"
+#include "timestamp.h"
+#include "wavelet_matrix.h"
+
+//! Persistent columnar index of a TSV log file.
+//!
+//! The index is a binary sidecar file (see `Index::pathFor()`), laid out as:
+//! - a header (magic, size and modification time of the indexed input, row
+//!   and query counts, size of the query bytes, parameters of the aggregation
+//!   tree),
+//! - the query dictionary: `query count + 1` 64 bit offsets into the
+//!   concatenated query bytes, followed by these bytes (padded to 8 bytes),
+//! - the timestamp column: one 64 bit timestamp per row, sorted,
+//! - the query column: one 32 bit query id per row, parallel to the
+//!   timestamp column (padded to 8 bytes),
+//! - the aggregation tree: the rows are grouped in fixed time buckets (see
+//!   `Builder::MinBucketWidth`), whose query counts are stored as well as the
+//!   counts of each group of `Fanout` consecutive buckets, then of each group
+//!   of `Fanout` consecutive groups, and so on up to a single root. Nodes are
+//!   stored level by level, as offsets into a single array of (query id,
+//!   count) pairs,
+//! - the previous occurrences: for each row, the position (plus one, 0 for
+//!   none) of the previous row of the same query, as a `WaveletMatrix`.
+//!
+//! Counting the queries of an arbitrary range then merges the counts of
+//! O(Fanout log(buckets)) nodes, plus the rows of the partial buckets at the
+//! edges of the range, instead of all the rows of the range. The distinct
+//! queries of a range are its rows whose previous occurrence is before the
+//! range, so they are counted in O(log rows), without visiting any row.
+//!
+//! All integers are stored in native byte order, so that the index can be
+//! used straight from a memory mapping.
+class Index
+{
+public:
+    typedef std::uint32_t QueryId;
+
+    //! Number of children of each node of the aggregation tree.
+    static const std::size_t Fanout = 16;
+
+    //! Occurrences of a query within a node of the aggregation tree.
+    struct QueryCount
+    {
+        QueryId id;
+        std::uint32_t count;
+    };
+
+    //! Version of an input file: an index is only used for the version it was
+    //! built from.
+    struct Source
+    {
+        std::uint64_t size;
+        std::int64_t mtimeSeconds;
+        std::int64_t mtimeNanoseconds;
+
+        inline bool operator!=(const Source& other) const
+        { return size != other.size || mtimeSeconds != other.mtimeSeconds || mtimeNanoseconds != other.mtimeNanoseconds; }
+    };
+
+    //! Accumulates rows, then builds or writes them as an index.
+    class Builder
+    {
+    public:
+        //! Width (in seconds) of the buckets, doubled as long as there are more
+        //! buckets than rows, to bound the size of sparse logs' trees.
+        static const Timestamp::Value MinBucketWidth = 60;
+
+        //! Record the version of the input the rows are read from (none by
+        //! default, for indexes only built in memory).
+        inline void setSource(const Source& source)
+        { source_ = source; }
+
+        //! Add a row to the index.
+        //!
+        //! @return false if the query is past the distinct queries a
+        //!         `QueryId` can number, the index then not being buildable.
+        bool add(const Timestamp& timestamp, std::string_view query);
+
+        //! Build the index in memory (consuming the added rows).
+        Index build();
+
+        //! Write the index (consuming the added rows), atomically replacing
+        //! any existing file.
+        //!
+        //! @return false if the index couldn't be written.
+        bool write(const std::string& path);
+
+    private:
+        //! Serialize the index, in 64 bit words (so that it is aligned as if
+        //! memory mapped), returning its size in bytes.
+        std::size_t serialize(std::vector<std::uint64_t>& words);
+
+        Source source_{ 0, 0, 0 };
+        StringInterner queries_;
+        std::vector<std::pair<Timestamp::Value, QueryId>> rows_;
+    };
+
+    //! Path of the index sidecar file of an input file.
+    static std::string pathFor(const std::string& input_filename);
+
+    //! Version of an input file.
+    //!
+    //! @return The version, or none if the file isn't a regular file.
+    static std::optional<Source> sourceOf(const std::string& input_filename);
+
+    //! Open the index of an input file, if it exists and is up to date (i.e.
+    //! built from the current size and modification time of the input file,
+    //! to the nanosecond).
+    static std::optional<Index> openFor(const std::string& input_filename);
+
+    //! Open an index file.
+    //!
+    //! @return The index, or none if the file isn't a valid index.
+    static std::optional<Index> open(const std::string& path);
+
+    //! Number of distinct queries in the index.
+    std::size_t queryCount() const;
+
+    //! The query of a given id.
+    std::string_view query(QueryId id) const;
+
+    //! Query ids of the rows within a timestamp range (inclusive).
+    std::pair<const QueryId*, const QueryId*> rowsInRange(const Timestamp& from, const Timestamp& to) const;
+
+    //! Number of distinct queries within a timestamp range (inclusive).
+    std::size_t distinctInRange(const Timestamp& from, const Timestamp& to) const;
+
+    //! Call `f(id, count)` with the occurrences of the queries within a
+    //! timestamp range (inclusive), using the aggregation tree.
+    //!
+    //! The same query can be visited several times, its occurrences in the
+    //! range being the sum of the visited counts.
+    template <typename F>
+    void countInRange(const Timestamp& from, const Timestamp& to, F f) const
+    {
+        std::vector<std::pair<const QueryId*, const QueryId*>> rows;
+        std::vector<std::pair<const QueryCount*, const QueryCount*>> nodes;
+        decomposeRange(from, to, rows, nodes);
+
+        for (auto [begin, end] : rows) {
+            for (auto it = begin; it != end; ++it)
+                f(*it, 1u);
+        }
+        for (auto [begin, end] : nodes) {
+            for (auto it = begin; it != end; ++it)
+                f(it->id, it->count);
+        }
+    }
+
+    //! Occurrences of the queries within ranges of an index, summed in a flat
+    //! array reused from one range to the next (e.g. by the requests of a
+    //! connection), only the entries touched by a range being cleared.
+    class RangeCounts
+    {
+    public:
+        //! Call `f(id, count)` once for each query within a timestamp range
+        //! (inclusive) of an index, with its number of occurrences.
+        template <typename F>
+        void visit(const Index& index, const Timestamp& from, const Timestamp& to, F f)
+        {
+            if (counts_.size() < index.queryCount())
+                counts_.resize(index.queryCount(), 0);
+
+            index.countInRange(from, to, [this](QueryId id, unsigned int count) {
+                if (counts_[id] == 0)
+                    ids_.push_back(id);
+                counts_[id] += count;
+            });
+
+            for (QueryId id : ids_) {
+                unsigned int count = counts_[id];
+                counts_[id] = 0;
+                f(id, count);
+            }
+            ids_.clear();
+        }
+
+    private:
+        std::vector<unsigned int> counts_;
+        std::vector<QueryId> ids_;
+    };
+
+private:
+    Index();
+
+    //! Point into serialized index contents.
+    //!
+    //! @return false if the contents aren't a valid index.
+    bool load(std::string_view contents);
+
+    //! Split a range into the rows of the partial buckets at its edges, and
+    //! the nodes of the aggregation tree covering its full buckets.
+    void decomposeRange(const Timestamp& from, const Timestamp& to,
+                        std::vector<std::pair<const QueryId*, const QueryId*>>& rows,
+                        std::vector<std::pair<const QueryCount*, const QueryCount*>>& nodes) const;
+
+    // owner of the contents, when mapped or in memory
+    std::optional<MappedFile> file_;
+    std::vector<std::uint64_t> memory_;
+
+    Source source_;
+    std::size_t rowCount_;
+    std::size_t queryCount_;
+    const std::uint64_t* queryOffsets_;
+    const char* queryBytes_;
+    const Timestamp::Value* timestamps_;
+    const QueryId* queryIds_;
+
+    Timestamp::Value bucketOrigin_;
+    Timestamp::Value bucketWidth_;
+    std::size_t bucketCount_;
+
+    // number of nodes of each level of the aggregation tree, from the buckets
+    // to the root
+    std::vector<std::size_t> levelSizes_;
+    const std::uint64_t* nodeOffsets_;
+    const QueryCount* nodeCounts_;
+
+    WaveletMatrix previousRows_;
+};
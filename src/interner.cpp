@@ -0,0 +1,102 @@
+#include "interner.h"
+
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include "hash.h"
+
+namespace {
+
+const std::size_t BlockSize = 1 << 20;
+const std::size_t InitialSlots = 1 << 10;
+
+const StringInterner::Id EmptySlot = std::numeric_limits<StringInterner::Id>::max();
+
+} // namespace
+
+StringInterner::StringInterner(Storage storage):
+    storage_(storage),
+    blockPos_(nullptr),
+    blockRemaining_(0),
+    blocksSize_(0),
+    slots_(InitialSlots, Slot{ 0, EmptySlot }),
+    mask_(InitialSlots - 1)
+{
+}
+
+StringInterner::Id StringInterner::intern(std::string_view str)
+{
+    std::uint64_t str_hash = hashString(str);
+    std::size_t slot = str_hash & mask_;
+    while (slots_[slot].id != EmptySlot) {
+        if (slots_[slot].hash == str_hash && strings_[slots_[slot].id] == str)
+            return slots_[slot].id;
+        slot = (slot + 1) & mask_;
+    }
+
+    Id id = static_cast<Id>(strings_.size());
+    strings_.push_back(store(str));
+    slots_[slot] = Slot{ str_hash, id };
+
+    // keep the load factor under 1/2, so that probe sequences stay short
+    if (strings_.size() * 2 > slots_.size())
+        grow();
+
+    return id;
+}
+
+void StringInterner::grow()
+{
+    std::vector<Slot> slots(slots_.size() * 2, Slot{ 0, EmptySlot });
+    mask_ = slots.size() - 1;
+
+    // slots are moved in order of their previous position, so that the
+    // strings of a probe sequence keep their relative order
+    for (const Slot& previous : slots_) {
+        if (previous.id == EmptySlot)
+            continue;
+
+        std::size_t slot = previous.hash & mask_;
+        while (slots[slot].id != EmptySlot)
+            slot = (slot + 1) & mask_;
+        slots[slot] = previous;
+    }
+    slots_ = std::move(slots);
+}
+
+std::size_t StringInterner::memoryUsage() const
+{
+    // the unused end of the current block isn't touched, thus not resident
+    return blocksSize_ - blockRemaining_
+        + blocks_.capacity() * sizeof(blocks_[0])
+        + strings_.capacity() * sizeof(strings_[0])
+        + slots_.capacity() * sizeof(slots_[0]);
+}
+
+std::string_view StringInterner::store(std::string_view str)
+{
+    if (storage_ == Storage::View || str.empty())
+        return str;
+
+    if (str.size() > blockRemaining_) {
+        // large strings get their own block, leaving the current one open
+        if (str.size() > BlockSize / 4) {
+            blocks_.emplace_back(new char[str.size()]);
+            blocksSize_ += str.size();
+            std::memcpy(blocks_.back().get(), str.data(), str.size());
+            return std::string_view(blocks_.back().get(), str.size());
+        }
+
+        blocks_.emplace_back(new char[BlockSize]);
+        blocksSize_ += BlockSize;
+        blockPos_ = blocks_.back().get();
+        blockRemaining_ = BlockSize;
+    }
+
+    std::memcpy(blockPos_, str.data(), str.size());
+    std::string_view stored(blockPos_, str.size());
+    blockPos_ += str.size();
+    blockRemaining_ -= str.size();
+    return stored;
+}
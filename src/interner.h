@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+//! Maps strings to dense integer ids.
+//!
+//! Interned strings are either copied contiguously into a bump arena (so
+//! that each distinct string only costs its bytes, without any per-string
+//! allocation), or referenced as is when their storage is known to outlive
+//! the interner (e.g. a memory mapped file).
+//!
+//! Ids are looked up in an open addressing table (linear probing) of ids, so
+//! that each distinct string costs about 64 bytes on top of its own bytes,
+//! instead of a hash table node. Slots are chosen by the lowest bits of the
+//! hash of their string, and keep the whole 64 bit hash next to its id, so
+//! that probing only compares the strings whose hashes match (instead of
+//! loading each probed string), and growing only moves the slots (without
+//! hashing the strings again).
+class StringInterner
+{
+public:
+    typedef std::uint32_t Id;
+
+    enum class Storage
+    {
+        Copy, //!< Copy interned strings into the arena.
+        View, //!< Reference interned strings, which must outlive the interner.
+    };
+
+    explicit StringInterner(Storage storage = Storage::Copy);
+
+    StringInterner(StringInterner&&) = default;
+    StringInterner& operator=(StringInterner&&) = default;
+
+    //! Intern a string.
+    //!
+    //! @return The id of the string, ids being attributed from 0 in order of
+    //!         first insertion.
+    Id intern(std::string_view str);
+
+    //! How interned strings are stored.
+    inline Storage storage() const
+    { return storage_; }
+
+    //! The string of an id returned by `intern()`.
+    inline std::string_view get(Id id) const
+    { return strings_[id]; }
+
+    //! Number of distinct strings interned.
+    inline std::size_t size() const
+    { return strings_.size(); }
+
+    //! Number of slots of the lookup table.
+    inline std::size_t bucketCount() const
+    { return slots_.size(); }
+
+    //! Approximate number of bytes used by the interner.
+    std::size_t memoryUsage() const;
+
+private:
+    struct Slot
+    {
+        std::uint64_t hash;
+        Id id;
+    };
+
+    std::string_view store(std::string_view str);
+    void grow();
+
+    Storage storage_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* blockPos_;
+    std::size_t blockRemaining_;
+    std::size_t blocksSize_;
+    std::vector<std::string_view> strings_;
+    std::vector<Slot> slots_;
+    std::size_t mask_;
+};
@@ -1,95 +1,162 @@
+#include <algorithm>
+#include <chrono>
 #include <fstream>
-#include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <limits>
 #include <optional>
 #include <string>
 #include <string_view>
-#include <unordered_set>
-
-#include <getopt.h>
-
+#include <thread>
+#include <vector>
+
+#include "batch.h"
+#include "commands.h"
+#include "hash.h"
+#include "hyperloglog.h"
+#include "index.h"
 #include "options.h"
-#include "ranker.h"
+#include "partial.h"
+#include "request.h"
+#include "scan.h"
+#include "server.h"
+#include "stats.h"
 #include "timestamp.h"
-#include "tsv_reader.h"
 
-std::string quote(std::string_view str)
+void printUsage(std::ostream& output, const Options& options)
 {
-    std::ostringstream stream;
-    stream << "\"" << str << "\"";
-    return stream.str();
+    output << "Usage: "
+        << "\n\thnStat top nb_top_queries [--from TIMESTAMP] [--to TIMESTAMP] [--threads N] [--sorted] [--approx [--capacity K] | --memory-limit MIB] [input_file...]"
+        << "\n\thnStat top nb_top_queries --window SECONDS [--step SECONDS] [--from TIMESTAMP] [--to TIMESTAMP] [input_file]"
+        << "\n\thnStat top nb_top_queries --follow [--interval SECONDS] [--from TIMESTAMP] [--to TIMESTAMP] input_file"
+        << "\n\thnStat distinct [--from TIMESTAMP] [--to TIMESTAMP] [--threads N] [--sorted] [--approx [--precision P] | --memory-limit MIB] [input_file...]"
+        << "\n\thnStat top nb_top_queries --partial PATH [--from TIMESTAMP] [--to TIMESTAMP] [--threads N] [--sorted] [--memory-limit MIB] [input_file...]"
+        << "\n\thnStat distinct --partial PATH [--from TIMESTAMP] [--to TIMESTAMP] [--threads N] [--sorted] [--approx [--precision P] | --memory-limit MIB] [input_file...]"
+        << "\n\thnStat merge top nb_top_queries [--memory-limit MIB] partial_file..."
+        << "\n\thnStat merge distinct [--memory-limit MIB] partial_file..."
+        << "\n\thnStat histogram --bucket SECONDS [--from TIMESTAMP] [--to TIMESTAMP] [--threads N] [--sorted] [input_file...]"
+        << "\n\thnStat index input_file"
+        << "\n\thnStat serve [--socket PATH] input_file"
+        << "\n\thnStat batch [--threads N] [--sorted] requests_file [input_file]"
+        << "\n\nWithout input_file (or with -), top and distinct read the standard input. Given several input files (or"
+        << "\ndirectories, standing for the files they contain), they count the queries of all of them."
+        << "\n\nWith --follow, top keeps reading input_file as it grows (like tail -F), printing \"# TIME\" then the top queries"
+        << "\nof all the rows read so far every --interval."
+        << "\n\nWith --window, top reads a time-sorted input once, printing \"# START END\" then the top queries of each window."
+        << "\n\nhistogram prints \"START TOTAL DISTINCT\" for each --bucket long bucket (starting at --from, or the epoch),"
+        << "\nfrom the first to the last bucket with a query: the number of queries of the bucket and of distinct ones."
+        << "\n\nWith --partial, top and distinct write the partial aggregate of their input to PATH (- for the standard output)"
+        << "\ninstead of printing a result: the counts of all the queries within the range, or a distinct sketch with --approx."
+        << "\nmerge then prints the top queries or distinct count of the partial aggregates of several shards, as if their"
+        << "\ninputs were read together (estimating the distinct count if any of them is a sketch)."
+        << "\n\nserve loads input_file once, then answers requests (e.g. \"top 10 --from TIMESTAMP\" or \"distinct\"), one per line,"
+        << "\nfrom the standard input or the connections to --socket. Each answer ends with \"ok LATENCY ms\" or \"error MESSAGE\"."
+        << "\n\nbatch answers the requests of requests_file (one per line, as served) reading input_file once,"
+        << "\neach answer being preceded by \"# REQUEST\"."
+        << "\n\n" << options.help()
+        << std::endl;
 }
 
-template <typename F>
-void onValidLines(std::istream& stream, F f)
+//! Parse the value of an integer option, within [min, max].
+//!
+//! `value` is left untouched if the option isn't given.
+//!
+//! @return false (after reporting the error) if the option value is invalid.
+template <typename T>
+bool parseIntegerOption(const char* program, const Arguments& arguments, const std::string& name, T min, T max, T& value)
 {
-    TSVReader reader(stream);
-    std::vector<std::string_view> row;
-    while (reader.readNextRow(row)) {
-        if (row.size() != 2) {
-            std::cerr << "invalid line: expected 2 columns" << std::endl;
-            continue;
+    auto value_str = arguments.getOption(name);
+    if (!value_str)
+        return true;
+
+    try {
+        long long parsed = std::stoll(std::string(*value_str));
+        if (parsed < static_cast<long long>(min) || parsed > static_cast<long long>(max)) {
+            std::cerr << program << ": " << "--" << name << " expects an integer in [" << min << ", " << max << "], got " << parsed << std::endl;
+            return false;
         }
-
-        std::string_view timestamp_str = row[0];
-        std::string_view query = row[1];
-
-        auto timestamp = Timestamp::parse(timestamp_str);
-        if (!timestamp) {
-            std::cerr << "invalid line: " << quote(timestamp_str) << " is not a valid timestamp" << std::endl;
-            continue;
-        }
-
-        f(*timestamp, query);
+        value = static_cast<T>(parsed);
+    } catch (const std::logic_error&) {
+        std::cerr << program << ": " << "--" << name << " received an invalid integer " << std::quoted(*value_str) << std::endl;
+        return false;
     }
+    return true;
 }
 
-template <typename F>
-void onTimestampRange(std::istream& stream, const Timestamp& start_timestamp, const Timestamp& end_timestamp, F f)
+//! Parse the number of top queries to print.
+//!
+//! @return false (after reporting the error) if the number is missing or
+//!         invalid.
+bool parseTopCount(const char* program, const std::optional<std::string>& count_str, int& n)
 {
-    onValidLines(stream, [&](const Timestamp& timestamp, std::string_view query) {
-        if (timestamp < start_timestamp || end_timestamp < timestamp)
-            return;
-        f(query);
-    });
-}
-
-void printTopN(std::istream& input, std::ostream& output, Timestamp start_timestamp, Timestamp end_timestamp, unsigned int n)
-{
-    if (n == 0)
-        return;
-
-    MaxOccurrenceRanker<std::string, std::string_view> ranker(n);
-
-    // rank queries in the given timestamp range
-    onTimestampRange(input, start_timestamp, end_timestamp, [&ranker](std::string_view query) {
-        ranker.update(query);
-    });
+    if (!count_str) {
+        std::cerr << program << ": " << "no maximum number of elements given" << std::endl;
+        return false;
+    }
 
-    // print out the top n elements
-    ranker.visit([&output](std::string_view query, unsigned int count) {
-        output << query << ' ' << count << '\n';
-    });
-    output.flush();
+    try {
+        n = std::stoi(*count_str);
+        if (n < 0)
+        {
+            std::cerr << program << ": " << "expected a positive integer, got " << n << std::endl;
+            return false;
+        }
+    } catch (const std::invalid_argument&) {
+        std::cerr << program << ": " << std::quoted(*count_str) << " is not an integer" << std::endl;
+        return false;
+    } catch (const std::out_of_range&) {
+        std::cerr << program << ": " << std::quoted(*count_str) << " is too large" << std::endl;
+        return false;
+    }
+    return true;
 }
 
-void printDistinctCount(std::istream& input, std::ostream& output, Timestamp start_timestamp, Timestamp end_timestamp)
+//! Write the partial aggregate of input files (see `--partial`): the counts
+//! of their queries, or a distinct sketch of the given precision.
+//!
+//! @return false (after reporting the error) if an input isn't readable or
+//!         the partial aggregate couldn't be written.
+bool writePartialOf(const char* program, const std::vector<std::string>& inputs, const std::string& path,
+                    const ScanOptions& scan, std::optional<unsigned int> precision, std::size_t memory_limit)
 {
-    std::unordered_set<std::string> queries;
-    onTimestampRange(input, start_timestamp, end_timestamp,
-                     [&](std::string_view q) { queries.emplace(q); });
-
-    output << queries.size() << std::endl;
+    bool written = false;
+    auto unreadable = withInputs(inputs, [&](auto&& input) {
+        if (precision) {
+            written = writeApproxPartial(input, path, scan, *precision);
+        } else {
+            written = writePartial(input, path, scan, memory_limit);
+        }
+    });
+    if (unreadable) {
+        std::cerr << program << ": " << "file " << std::quoted(*unreadable) << " not readable" << std::endl;
+        return false;
+    }
+    if (!written) {
+        std::cerr << program << ": " << "could not write the partial aggregate to " << std::quoted(path) << std::endl;
+        return false;
+    }
+    return true;
 }
 
-void printUsage(std::ostream& output, const Options& options)
+//! Collect the remaining positional arguments as input files, directories
+//! being replaced by the files they contain (see `expandInputs()`), or the
+//! standard input if there are none.
+//!
+//! @return false (after reporting the error) if a directory isn't readable.
+template <typename Positional>
+bool collectInputs(const char* program, Positional& positional, std::vector<std::string>& inputs)
 {
-    output << "Usage: "
-        << "\n\thnStat top nb_top_queries [--from TIMESTAMP] [--to TIMESTAMP] input_file"
-        << "\n\thnStat distinct [--from TIMESTAMP] [--to TIMESTAMP] input_file"
-        << "\n\n" << options.help()
-        << std::endl;
+    std::vector<std::string> filenames;
+    while (auto filename = positional.next())
+        filenames.push_back(*filename);
+    if (filenames.empty())
+        filenames.push_back(StdinFilename);
+
+    if (auto error = expandInputs(filenames, inputs)) {
+        std::cerr << program << ": " << *error << std::endl;
+        return false;
+    }
+    return true;
 }
 
 int main(int argc, char* argv[])
@@ -97,7 +164,22 @@ int main(int argc, char* argv[])
     auto options = Options({
             Option('h', "help", "Display this help"),
             LongOption("from", ArgumentRequired, "Minimum (inclusive) timestamp to consider. Defaults to all timestamps"),
-            LongOption("to", ArgumentRequired, "Maximum (inclusive) timestamp to consider. Default to all timestamps.")
+            LongOption("to", ArgumentRequired, "Maximum (inclusive) timestamp to consider. Default to all timestamps."),
+            LongOption("threads", ArgumentRequired, "Number of threads scanning the input file. Defaults to the number of cores."),
+            LongOption("sorted", "Trust the input file to be sorted by timestamp, only reading the lines within the range"),
+            LongOption("approx", "Estimate the result instead of computing it exactly, in bounded memory"),
+            LongOption("capacity", ArgumentRequired, "Maximum number of queries tracked by the top estimation (--approx), each line then ends with the maximum overestimation of the count (0 when exact). Defaults to 100 times nb_top_queries"),
+            LongOption("precision", ArgumentRequired, "Precision of the distinct estimation (--approx), from 4 to 18. Each increment halves the error and doubles the memory. Defaults to 14 (0.8% error, 16 KiB)"),
+            LongOption("memory-limit", ArgumentRequired, "Memory (in MiB) the exact counts of the queries may use, beyond which they are spilled to temporary files (in $TMPDIR, or /tmp). Defaults to unlimited"),
+            LongOption("partial", ArgumentRequired, "Path to write the partial aggregate of the input to (- for the standard output), instead of printing the result (see the merge command)"),
+            LongOption("no-index", "Read the input file even if it has an up to date index (see the index command)"),
+            LongOption("follow", "Keep reading the input file as it grows, periodically printing the top queries (see --interval)"),
+            LongOption("interval", ArgumentRequired, "Seconds between the refreshes of the top queries (--follow). Defaults to 10"),
+            LongOption("window", ArgumentRequired, "Length (in seconds) of the sliding windows to rank the queries of, the input being sorted by timestamp"),
+            LongOption("step", ArgumentRequired, "Seconds between the starts of consecutive windows (--window). Defaults to the window length"),
+            LongOption("bucket", ArgumentRequired, "Length (in seconds) of the buckets of the histogram command"),
+            LongOption("stats", ArgumentOptional, "Print statistics of the run to the standard error: time per phase, rows read and rejected, hash table size, peak memory and hardware counters. --stats=json prints them as JSON"),
+            LongOption("socket", ArgumentRequired, "Path of the Unix domain socket to serve requests on (see the serve command). Defaults to the standard input")
             });
 
     Parser parser(options);
@@ -110,29 +192,62 @@ int main(int argc, char* argv[])
         return EXIT_SUCCESS;
     }
 
-    Timestamp start_timestamp = Timestamp::Min;
-    if (auto timstamp_str = arguments->getOption("from")) {
-        auto timestamp = Timestamp::parse(*timstamp_str);
-        if (!timestamp) {
-            std::cerr << argv[0] << ": " << "--from received an invalid timestamp" << std::endl;
+    std::optional<Stats::Format> stats_format;
+    if (arguments->hasOption("stats")) {
+        auto format_str = arguments->getOption("stats");
+        if (!format_str || *format_str == "text") {
+            stats_format = Stats::Format::Text;
+        } else if (*format_str == "json") {
+            stats_format = Stats::Format::Json;
+        } else {
+            std::cerr << argv[0] << ": " << "--stats expects text or json, got " << std::quoted(std::string(*format_str)) << std::endl;
             return EXIT_FAILURE;
         }
-        start_timestamp = *timestamp;
     }
 
-    Timestamp end_timestamp = Timestamp::Max;
-    if (auto timstamp_str = arguments->getOption("to")) {
-        auto timestamp = Timestamp::parse(*timstamp_str);
-        if (!timestamp) {
-            std::cerr << argv[0] << ": " << "--to received an invalid timestamp" << std::endl;
-            return EXIT_FAILURE;
+    // report the statistics however the command returns
+    struct StatsReport
+    {
+        std::optional<Stats::Format> format;
+
+        ~StatsReport()
+        {
+            if (format)
+                Stats::global().report(std::cerr, *format);
         }
-        end_timestamp = *timestamp;
+    } stats_report { stats_format };
+    if (stats_format)
+        Stats::global().start();
+
+    ScanOptions scan;
+
+    if (auto error = parseTimestampRange(*arguments, scan)) {
+        std::cerr << argv[0] << ": " << *error << std::endl;
+        return EXIT_FAILURE;
     }
 
-    if (end_timestamp < start_timestamp) {
-        std::cerr << argv[0] << ": " << "--from cannot receive a larger timestamp than the one specified with --to" << std::endl;
+    scan.threads = std::max(1u, std::thread::hardware_concurrency());
+    if (!parseIntegerOption(argv[0], *arguments, "threads", 1u, 1024u, scan.threads))
         return EXIT_FAILURE;
+
+    scan.sorted = arguments->hasOption("sorted");
+
+    bool approx = arguments->hasOption("approx");
+
+    unsigned int precision = HyperLogLog::DefaultPrecision;
+    if (!parseIntegerOption(argv[0], *arguments, "precision", HyperLogLog::MinPrecision, HyperLogLog::MaxPrecision, precision))
+        return EXIT_FAILURE;
+
+    std::optional<std::size_t> memory_limit;
+    if (arguments->hasOption("memory-limit")) {
+        std::size_t memory_limit_mib = 0;
+        if (!parseIntegerOption(argv[0], *arguments, "memory-limit", std::size_t(1), std::size_t(1) << 30, memory_limit_mib))
+            return EXIT_FAILURE;
+        if (approx) {
+            std::cerr << argv[0] << ": " << "--memory-limit cannot be combined with --approx, which is already bounded" << std::endl;
+            return EXIT_FAILURE;
+        }
+        memory_limit = memory_limit_mib << 20;
     }
 
     auto positionalArguments = arguments->getPositional();
@@ -145,57 +260,344 @@ int main(int argc, char* argv[])
 
     static const std::string PrintTopNCommand = "top";
     static const std::string PrintDistinctCommand = "distinct";
+    static const std::string IndexCommand = "index";
+    static const std::string ServeCommand = "serve";
+    static const std::string BatchCommand = "batch";
+    static const std::string MergeCommand = "merge";
+    static const std::string HistogramCommand = "histogram";
+
+    bool use_index = !arguments->hasOption("no-index");
+
+    // partial aggregates are merged with a single counter, whatever their size
+    std::size_t counter_memory_limit = memory_limit.value_or(std::numeric_limits<std::size_t>::max());
+    auto partial_path = arguments->getOption("partial");
 
     if (command == PrintTopNCommand) {
-        auto count_str = positionalArguments.next();
-        if (!count_str) {
-            std::cerr << argv[0] << ": " << "no maximum number of elements given" << std::endl;
+        int n;
+        if (!parseTopCount(argv[0], positionalArguments.next(), n))
+            return EXIT_FAILURE;
+
+        std::vector<std::string> inputs;
+        if (!collectInputs(argv[0], positionalArguments, inputs))
+            return EXIT_FAILURE;
+        bool single_file = inputs.size() == 1 && inputs.front() != StdinFilename;
+
+        // tracking fewer than n queries can't rank n of them (and tracking
+        // more than 16M queries would take gigabytes per thread)
+        static const unsigned int MaxCapacity = 1 << 24;
+        if (approx && static_cast<unsigned int>(n) > MaxCapacity) {
+            std::cerr << argv[0] << ": " << "--approx tracks at most " << MaxCapacity << " queries, got " << n << " top queries to rank" << std::endl;
             return EXIT_FAILURE;
         }
+        unsigned int capacity = std::clamp(100ull * n, 1ull, static_cast<unsigned long long>(MaxCapacity));
+        unsigned int min_capacity = std::clamp(static_cast<unsigned int>(n), 1u, MaxCapacity);
+        if (!parseIntegerOption(argv[0], *arguments, "capacity", min_capacity, MaxCapacity, capacity))
+            return EXIT_FAILURE;
 
-        int n;
-        try {
-            n = std::stoi(*count_str);
-            if (n < 0)
-            {
-                std::cerr << argv[0] << ": " << "expected a positive integer, got " << n << std::endl;
+        if (arguments->hasOption("follow")) {
+            if (!single_file) {
+                std::cerr << argv[0] << ": " << "--follow requires a single input file" << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (approx || memory_limit || partial_path || arguments->hasOption("window")) {
+                std::cerr << argv[0] << ": " << "--follow cannot be combined with --approx, --memory-limit, --partial nor --window" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // following never returns, the process ending on a signal
+            if (stats_format) {
+                std::cerr << argv[0] << ": " << "--follow runs until interrupted, it cannot report --stats" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            unsigned int interval = 10;
+            if (!parseIntegerOption(argv[0], *arguments, "interval", 1u, 24u * 60 * 60, interval))
+                return EXIT_FAILURE;
+
+            FollowTSVReader reader(inputs.front());
+            if (!reader.open()) {
+                std::cerr << argv[0] << ": " << "file " << std::quoted(inputs.front()) << " not readable" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            followTopN(reader, std::cout, scan, n, std::chrono::seconds(interval));
+            return EXIT_SUCCESS;
+        }
+
+        if (arguments->hasOption("window")) {
+            if (approx || memory_limit || partial_path) {
+                std::cerr << argv[0] << ": " << "--window cannot be combined with --approx, --memory-limit nor --partial" << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (inputs.size() != 1) {
+                std::cerr << argv[0] << ": " << "--window requires a single input" << std::endl;
+                return EXIT_FAILURE;
+            }
+            const std::string& filename = inputs.front();
+
+            static const Timestamp::Value MaxWindow = Timestamp::Value(1) << 40;
+            Timestamp::Value window = 0;
+            if (!parseIntegerOption(argv[0], *arguments, "window", Timestamp::Value(1), MaxWindow, window))
+                return EXIT_FAILURE;
+            Timestamp::Value step = window;
+            if (!parseIntegerOption(argv[0], *arguments, "step", Timestamp::Value(1), MaxWindow, step))
+                return EXIT_FAILURE;
+
+            bool readable = withInput(filename, [&](auto&& input) {
+                printWindowedTopN(input, std::cout, scan, n, window, step);
+            });
+            if (!readable) {
+                std::cerr << argv[0] << ": " << "file " << std::quoted(filename) << " not readable" << std::endl;
                 return EXIT_FAILURE;
             }
-        } catch (std::invalid_argument) {
-            std::cerr << argv[0] << ": " << std::quoted(*count_str) << " is not an integer" << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        if (partial_path) {
+            if (approx) {
+                std::cerr << argv[0] << ": " << "top cannot write an approximate partial aggregate, only distinct can (a sketch)" << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (!writePartialOf(argv[0], inputs, std::string(*partial_path), scan, std::nullopt, counter_memory_limit))
+                return EXIT_FAILURE;
+            return EXIT_SUCCESS;
+        }
+
+        // an index gives exact counts faster than scanning for estimations
+        if (auto index = use_index && single_file ? Index::openFor(inputs.front()) : std::nullopt) {
+            printTopN(*index, std::cout, scan, n, approx);
+            return EXIT_SUCCESS;
+        }
+
+        bool counted = true;
+        auto unreadable = withInputs(inputs, [&](auto&& input) {
+            if (approx) {
+                printApproxTopN(input, std::cout, scan, n, capacity);
+            } else if (memory_limit) {
+                counted = printBoundedTopN(input, std::cout, scan, n, *memory_limit);
+            } else {
+                printTopN(input, std::cout, scan, n);
+            }
+        });
+        if (unreadable) {
+            std::cerr << argv[0] << ": " << "file " << std::quoted(*unreadable) << " not readable" << std::endl;
             return EXIT_FAILURE;
-        } catch (std::out_of_range) {
-            std::cerr << argv[0] << ": " << std::quoted(*count_str) << " is too large" << std::endl;
+        }
+        if (!counted) {
+            std::cerr << argv[0] << ": " << "could not spill the counts to temporary files" << std::endl;
             return EXIT_FAILURE;
         }
+    } else if (command == PrintDistinctCommand) {
+        std::vector<std::string> inputs;
+        if (!collectInputs(argv[0], positionalArguments, inputs))
+            return EXIT_FAILURE;
 
+        if (partial_path) {
+            auto sketch_precision = approx ? std::optional<unsigned int>(precision) : std::nullopt;
+            if (!writePartialOf(argv[0], inputs, std::string(*partial_path), scan, sketch_precision, counter_memory_limit))
+                return EXIT_FAILURE;
+            return EXIT_SUCCESS;
+        }
+
+        // an index gives the exact count faster than scanning for an estimate
+        bool single_file = inputs.size() == 1 && inputs.front() != StdinFilename;
+        if (auto index = use_index && single_file ? Index::openFor(inputs.front()) : std::nullopt) {
+            printDistinctCount(*index, std::cout, scan);
+            return EXIT_SUCCESS;
+        }
+
+        bool counted = true;
+        auto unreadable = withInputs(inputs, [&](auto&& input) {
+            if (approx) {
+                printApproxDistinctCount(input, std::cout, scan, precision);
+            } else if (memory_limit) {
+                counted = printBoundedDistinctCount(input, std::cout, scan, *memory_limit);
+            } else {
+                printDistinctCount(input, std::cout, scan);
+            }
+        });
+        if (unreadable) {
+            std::cerr << argv[0] << ": " << "file " << std::quoted(*unreadable) << " not readable" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (!counted) {
+            std::cerr << argv[0] << ": " << "could not spill the counts to temporary files" << std::endl;
+            return EXIT_FAILURE;
+        }
+    } else if (command == IndexCommand) {
         auto filename = positionalArguments.next();
         if (!filename) {
             std::cerr << argv[0] << ": " << "no filename given" << std::endl;
             return EXIT_FAILURE;
         }
 
-        std::ifstream file(*filename);
-        if (!file) {
-            std::cerr << argv[0] << ": " << "file " << std::quoted(*filename) << " not readable" << std::endl;
+        // only regular files can be indexed, since the index is only used for
+        // the size and modification time of its input file (taken before
+        // reading it, so that a change while indexing invalidates the index)
+        auto source = Index::sourceOf(*filename);
+        auto mapped_file = source ? MappedFile::open(*filename) : std::nullopt;
+        if (!mapped_file) {
+            std::cerr << argv[0] << ": " << "file " << std::quoted(*filename) << " not a readable regular file" << std::endl;
             return EXIT_FAILURE;
         }
 
-        printTopN(file, std::cout, start_timestamp, end_timestamp, n);
-    } else if (command == PrintDistinctCommand) {
+        if (auto error = writeIndex(mapped_file->contents(), *source, Index::pathFor(*filename))) {
+            std::cerr << argv[0] << ": " << *error << std::endl;
+            return EXIT_FAILURE;
+        }
+    } else if (command == ServeCommand) {
         auto filename = positionalArguments.next();
         if (!filename) {
             std::cerr << argv[0] << ": " << "no filename given" << std::endl;
             return EXIT_FAILURE;
         }
 
-        std::ifstream file(*filename);
-        if (!file) {
-            std::cerr << argv[0] << ": " << "file " << std::quoted(*filename) << " not readable" << std::endl;
+        auto socket_path = arguments->getOption("socket");
+        if (*filename == StdinFilename && !socket_path) {
+            std::cerr << argv[0] << ": " << "requests are read from the standard input, serving it requires --socket" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        // load the rows once, from the index if it is up to date
+        std::optional<Index> index = use_index && *filename != StdinFilename ? Index::openFor(*filename) : std::nullopt;
+        if (!index) {
+            bool readable = withInput(*filename, [&](auto&& input) {
+                index = buildIndex(input);
+            });
+            if (!readable) {
+                std::cerr << argv[0] << ": " << "file " << std::quoted(*filename) << " not readable" << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (!index) {
+                std::cerr << argv[0] << ": " << "too many distinct queries to index" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        Server server(*index);
+        if (!socket_path) {
+            server.serve(std::cin, std::cout);
+        } else if (!server.listen(std::string(*socket_path))) {
+            std::cerr << argv[0] << ": " << "could not listen on socket " << std::quoted(std::string(*socket_path)) << std::endl;
+            return EXIT_FAILURE;
+        }
+    } else if (command == BatchCommand) {
+        auto requests_filename = positionalArguments.next();
+        if (!requests_filename) {
+            std::cerr << argv[0] << ": " << "no requests file given" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::ifstream requests_file(*requests_filename);
+        if (!requests_file) {
+            std::cerr << argv[0] << ": " << "file " << std::quoted(*requests_filename) << " not readable" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        RequestParser request_parser;
+        std::vector<Request> requests;
+        std::string line;
+        for (std::size_t line_number = 1; std::getline(requests_file, line); line_number++) {
+            // skip blank lines
+            if (line.find_first_not_of(" \t") == std::string::npos)
+                continue;
+
+            Request request;
+            if (auto error = request_parser.parse(line, request)) {
+                std::cerr << argv[0] << ": " << *requests_filename << ":" << line_number << ": " << *error << std::endl;
+                return EXIT_FAILURE;
+            }
+            requests.push_back(std::move(request));
+        }
+
+        // read the standard input if no file is given
+        std::string filename = positionalArguments.next().value_or(StdinFilename);
+
+        if (auto index = use_index && filename != StdinFilename ? Index::openFor(filename) : std::nullopt) {
+            printBatch(*index, std::cout, requests);
+            return EXIT_SUCCESS;
+        }
+
+        bool readable = withInput(filename, [&](auto&& input) {
+            printBatch(input, std::cout, scan, requests);
+        });
+        if (!readable) {
+            std::cerr << argv[0] << ": " << "file " << std::quoted(filename) << " not readable" << std::endl;
+            return EXIT_FAILURE;
+        }
+    } else if (command == HistogramCommand) {
+        if (!arguments->hasOption("bucket")) {
+            std::cerr << argv[0] << ": " << "histogram requires a --bucket length" << std::endl;
+            return EXIT_FAILURE;
+        }
+        static const Timestamp::Value MaxBucket = Timestamp::Value(1) << 40;
+        Timestamp::Value bucket = 0;
+        if (!parseIntegerOption(argv[0], *arguments, "bucket", Timestamp::Value(1), MaxBucket, bucket))
+            return EXIT_FAILURE;
+
+        std::vector<std::string> inputs;
+        if (!collectInputs(argv[0], positionalArguments, inputs))
+            return EXIT_FAILURE;
+
+        auto unreadable = withInputs(inputs, [&](auto&& input) {
+            printHistogram(input, std::cout, scan, bucket);
+        });
+        if (unreadable) {
+            std::cerr << argv[0] << ": " << "file " << std::quoted(*unreadable) << " not readable" << std::endl;
+            return EXIT_FAILURE;
+        }
+    } else if (command == MergeCommand) {
+        auto merged_command = positionalArguments.next();
+        int n = 0;
+        if (merged_command == PrintTopNCommand) {
+            if (!parseTopCount(argv[0], positionalArguments.next(), n))
+                return EXIT_FAILURE;
+        } else if (merged_command != PrintDistinctCommand) {
+            std::cerr << argv[0] << ": " << "merge expects a top or distinct command" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::vector<Partial> partials;
+        while (auto filename = positionalArguments.next()) {
+            auto partial = Partial::open(*filename);
+            if (!partial) {
+                std::cerr << argv[0] << ": " << "file " << std::quoted(*filename) << " not a readable partial aggregate" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // only counts give the top queries, and only sketches of the same
+            // precision and hash (the one the counted queries are added with)
+            // can be merged
+            if (merged_command == PrintTopNCommand && !partial->hasCounts()) {
+                std::cerr << argv[0] << ": " << "file " << std::quoted(*filename) << " holds a distinct sketch, not query counts" << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (!partial->hasCounts() && partial->hashVersion() != HashVersion) {
+                std::cerr << argv[0] << ": " << "file " << std::quoted(*filename) << " holds a sketch of hash version " << partial->hashVersion()
+                    << ", expected " << HashVersion << std::endl;
+                return EXIT_FAILURE;
+            }
+            for (const Partial& other : partials) {
+                if (!partial->hasCounts() && !other.hasCounts() && partial->sketch()->precision() != other.sketch()->precision()) {
+                    std::cerr << argv[0] << ": " << "file " << std::quoted(*filename) << " holds a sketch of precision " << partial->sketch()->precision()
+                        << ", others have precision " << other.sketch()->precision() << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+            partials.push_back(std::move(*partial));
+        }
+        if (partials.empty()) {
+            std::cerr << argv[0] << ": " << "no partial aggregate given" << std::endl;
             return EXIT_FAILURE;
         }
 
-        printDistinctCount(file, std::cout, start_timestamp, end_timestamp);
+        bool counted = merged_command == PrintTopNCommand
+            ? printMergedTopN(partials, std::cout, n, counter_memory_limit)
+            : printMergedDistinctCount(partials, std::cout, counter_memory_limit);
+        if (!counted) {
+            std::cerr << argv[0] << ": " << "could not spill the counts to temporary files" << std::endl;
+            return EXIT_FAILURE;
+        }
     } else {
         std::cerr << argv[0] << ": unrecognized command " << std::quoted(*command) << std::endl;
         return EXIT_FAILURE;
@@ -0,0 +1,74 @@
+#include "mapped_file.h"
+
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const char* data, std::size_t size):
+    data_(data),
+    size_(size)
+{
+}
+
+MappedFile::MappedFile(MappedFile&& other):
+    data_(std::exchange(other.data_, nullptr)),
+    size_(std::exchange(other.size_, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+    if (this != &other) {
+        this->~MappedFile();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_ && size_ > 0)
+        munmap(const_cast<char*>(data_), size_);
+}
+
+std::optional<MappedFile> MappedFile::open(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return std::nullopt;
+
+    auto file = map(fd);
+    close(fd); // the mapping keeps its own reference to the file
+    return file;
+}
+
+std::optional<MappedFile> MappedFile::map(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+        return std::nullopt;
+
+    std::size_t size = static_cast<std::size_t>(st.st_size);
+
+    // mmap() refuses empty mappings, but an empty file is still a valid input
+    if (size == 0)
+        return MappedFile(nullptr, 0);
+
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+        return std::nullopt;
+
+    // rows are read front to back, let the kernel read ahead aggressively
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    return MappedFile(static_cast<const char*>(data), size);
+}
+
+std::string_view MappedFile::contents() const
+{
+    return std::string_view(data_, size_);
+}
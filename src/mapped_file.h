@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+//! Read-only memory mapping of a whole regular file.
+//!
+//! The mapping is released when the object is destroyed, so any string view
+//! obtained from `contents()` must not outlive it.
+class MappedFile
+{
+    MappedFile(const char* data, std::size_t size);
+
+public:
+    MappedFile(MappedFile&& other);
+    MappedFile& operator=(MappedFile&& other);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    //! Map a file in memory.
+    //!
+    //! @param[in] path The path of the file to map.
+    //!
+    //! @return The mapped file, or none if the file isn't a readable regular
+    //!         file (pipes, sockets or character devices can't be mapped).
+    static std::optional<MappedFile> open(const std::string& path);
+
+    //! Map an open file in memory (see `open()`).
+    //!
+    //! The file descriptor isn't closed, nor needed once the file is mapped.
+    static std::optional<MappedFile> map(int fd);
+
+    //! View of the whole file contents.
+    std::string_view contents() const;
+
+private:
+    const char* data_;
+    std::size_t size_;
+};
@@ -322,6 +322,9 @@ std::optional<Arguments> Parser::parse(int argc, char* argv[]) const
 {
     Arguments arguments;
 
+    // fully reinitialize getopt, so that several argument lists can be parsed
+    optind = 0;
+
     int id;
     while ((id = getopt_long(argc, argv, optstring_.c_str(), &longopts_[0], NULL)) != -1) {
         auto findIt = optionsById_.find(id);
@@ -9,6 +9,8 @@
 #include <set>
 #include <vector>
 
+#include <getopt.h>
+
 #include "iterator.h"
 
 enum class ArgumentConstraint
@@ -0,0 +1,140 @@
+#include "partial.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include "hash.h"
+#include "stats.h"
+
+namespace {
+
+const char Magic[8] = { 'H', 'N', 'S', 'T', 'P', 'R', 'T', '2' };
+
+enum class Kind : std::uint32_t
+{
+    Counts,
+    Sketch,
+};
+
+struct Header
+{
+    char magic[8];
+    Kind kind;
+    std::uint32_t precision;
+    std::uint32_t hashVersion;
+};
+
+//! Write a partial aggregate with `write_contents(output)` (after its header),
+//! to the standard output if the path is "-".
+//!
+//! Files are written to a temporary file first, so that readers never see an
+//! incomplete partial aggregate.
+//!
+//! @return false if the file couldn't be written.
+template <typename F>
+bool writeFile(const std::string& path, Kind kind, std::uint32_t precision, F write_contents)
+{
+    Header header;
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.kind = kind;
+    header.precision = precision;
+    header.hashVersion = HashVersion;
+
+    auto write = [&](std::ostream& output) {
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        return write_contents(output) && output.flush();
+    };
+
+    if (path == "-")
+        return write(std::cout);
+
+    std::string tmp_path = path + ".tmp";
+    bool written;
+    {
+        std::ofstream output(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!output)
+            return false;
+        written = write(output);
+    }
+    if (!written) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+} // namespace
+
+bool Partial::write(const std::string& path, SpillingCounter& counter)
+{
+    return writeFile(path, Kind::Counts, 0, [&](std::ostream& output) {
+        return counter.visit([&](std::string_view query, SpillingCounter::Count count) {
+            std::uint32_t header[2] = { count, static_cast<std::uint32_t>(query.size()) };
+            output.write(reinterpret_cast<const char*>(header), sizeof(header));
+            output.write(query.data(), query.size());
+        });
+    });
+}
+
+bool Partial::write(const std::string& path, const HyperLogLog& sketch)
+{
+    return writeFile(path, Kind::Sketch, sketch.precision(), [&](std::ostream& output) {
+        output.write(reinterpret_cast<const char*>(sketch.registers().data()), sketch.registers().size());
+        return true;
+    });
+}
+
+std::optional<Partial> Partial::open(const std::string& path)
+{
+    Stats::ScopedPhase phase(Stats::Phase::Open);
+
+    auto file = MappedFile::open(path);
+    if (!file)
+        return std::nullopt;
+
+    std::string_view contents = file->contents();
+    Header header;
+    if (contents.size() < sizeof(Header))
+        return std::nullopt;
+    std::memcpy(&header, contents.data(), sizeof(Header));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0)
+        return std::nullopt;
+    contents.remove_prefix(sizeof(Header));
+
+    Partial partial(std::move(*file));
+    partial.hashVersion_ = header.hashVersion;
+    switch (header.kind) {
+        case Kind::Counts:
+            // check that the records are complete once, so that visiting them
+            // doesn't have to
+            for (std::string_view records = contents; !records.empty();) {
+                std::uint32_t record[2];
+                if (records.size() < sizeof(record))
+                    return std::nullopt;
+                std::memcpy(record, records.data(), sizeof(record));
+                if (records.size() - sizeof(record) < record[1])
+                    return std::nullopt;
+                records.remove_prefix(sizeof(record) + record[1]);
+            }
+            partial.records_ = contents;
+            return partial;
+
+        case Kind::Sketch:
+            if (header.precision < HyperLogLog::MinPrecision || header.precision > HyperLogLog::MaxPrecision)
+                return std::nullopt;
+            if (contents.size() != std::size_t(1) << header.precision)
+                return std::nullopt;
+            partial.sketch_.emplace(header.precision, reinterpret_cast<const std::uint8_t*>(contents.data()));
+            return partial;
+    }
+    return std::nullopt;
+}
+
+Partial::Partial(MappedFile file):
+    file_(std::move(file)),
+    hashVersion_(0)
+{
+}
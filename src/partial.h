@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "hyperloglog.h"
+#include "mapped_file.h"
+#include "spilling_counter.h"
+
+//! Partial aggregate of a shard of the logs, to be merged with the partial
+//! aggregates of the other shards (see `--partial` and the merge command),
+//! so that each shard is scanned where it is stored.
+//!
+//! A partial aggregate holds either the counts of all the queries within the
+//! scanned range, from which the exact top queries and distinct count of all
+//! the shards are merged, or only a distinct sketch, from which the distinct
+//! count is estimated. The file is laid out as:
+//! - a header (magic, kind, precision of the sketch, version of the hash of
+//!   the sketch, see `HashVersion`),
+//! - for counts, one record per query: its 32 bit count and length, followed
+//!   by its bytes, in no particular order,
+//! - for a sketch, its `2^precision` registers.
+//!
+//! All integers are stored in native byte order, so partial aggregates are
+//! only merged between machines of the same byte order.
+class Partial
+{
+public:
+    //! Write the counts of a counter as a partial aggregate, emptying it.
+    //!
+    //! @return false if the file couldn't be written (or the counts spilled).
+    static bool write(const std::string& path, SpillingCounter& counter);
+
+    //! Write a distinct sketch as a partial aggregate.
+    //!
+    //! @return false if the file couldn't be written.
+    static bool write(const std::string& path, const HyperLogLog& sketch);
+
+    //! Map a partial aggregate.
+    //!
+    //! @return The partial aggregate, or none if the file isn't a readable
+    //!         (and complete) partial aggregate.
+    static std::optional<Partial> open(const std::string& path);
+
+    //! Whether the partial aggregate holds query counts (or a sketch).
+    inline bool hasCounts() const
+    { return !sketch_; }
+
+    //! Version of the hash the partial aggregate was written with: sketches
+    //! are only merged with sketches of the same hash.
+    inline std::uint32_t hashVersion() const
+    { return hashVersion_; }
+
+    //! Distinct sketch of a partial aggregate without counts.
+    inline const std::optional<HyperLogLog>& sketch() const
+    { return sketch_; }
+
+    //! Call `f(query, count)` for each query of a partial aggregate with
+    //! counts, the views being valid as long as the partial aggregate.
+    template <typename F>
+    void visit(F f) const
+    {
+        std::string_view records = records_;
+        while (!records.empty()) {
+            std::uint32_t header[2];
+            std::memcpy(header, records.data(), sizeof(header));
+            f(records.substr(sizeof(header), header[1]), header[0]);
+            records.remove_prefix(sizeof(header) + header[1]);
+        }
+    }
+
+private:
+    explicit Partial(MappedFile file);
+
+    MappedFile file_;
+    std::uint32_t hashVersion_;
+    std::string_view records_;
+    std::optional<HyperLogLog> sketch_;
+};
@@ -0,0 +1,198 @@
+#include "pipelined_reader.h"
+
+#include <cerrno>
+#include <limits>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include "stats.h"
+
+namespace {
+
+const std::size_t NoBuffer = std::numeric_limits<std::size_t>::max();
+
+} // namespace
+
+PipelinedTSVReader::PipelinedTSVReader(int fd, std::size_t bufferSize, std::size_t bufferCount):
+    fd_(fd),
+    bufferSize_(bufferSize),
+    buffers_(bufferCount),
+    done_(false),
+    failed_(false),
+    stopping_(false),
+    current_(NoBuffer),
+    pos_(0),
+    carryEmitted_(false)
+{
+    for (std::size_t i = 0; i < buffers_.size(); i++) {
+        buffers_[i].data.reset(new char[bufferSize_]);
+        buffers_[i].size = 0;
+        freeBuffers_.push_back(i);
+    }
+
+    // lets the destructor interrupt a blocking read
+    if (pipe(wakeupPipe_) == -1) {
+        failed_ = true;
+        done_ = true;
+        return;
+    }
+
+    reader_ = std::thread(&PipelinedTSVReader::readLoop, this);
+}
+
+PipelinedTSVReader::~PipelinedTSVReader()
+{
+    if (!reader_.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    condition_.notify_all();
+
+    char wakeup = 0;
+    while (write(wakeupPipe_[1], &wakeup, 1) == -1 && errno == EINTR)
+        ;
+
+    reader_.join();
+    close(wakeupPipe_[0]);
+    close(wakeupPipe_[1]);
+}
+
+bool PipelinedTSVReader::failed() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_;
+}
+
+void PipelinedTSVReader::readLoop()
+{
+    for (;;) {
+        std::size_t i;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this] { return stopping_ || !freeBuffers_.empty(); });
+            if (stopping_)
+                return;
+            i = freeBuffers_.front();
+            freeBuffers_.pop_front();
+        }
+
+        // fill the buffer with as much as is available, only waiting for the
+        // input while the buffer is empty
+        Buffer& buffer = buffers_[i];
+        buffer.size = 0;
+        bool end = false;
+        bool failed = false;
+        while (buffer.size < bufferSize_) {
+            struct pollfd fds[2] = { { fd_, POLLIN, 0 }, { wakeupPipe_[0], POLLIN, 0 } };
+            int ready = poll(fds, 2, buffer.size == 0 ? -1 : 0);
+            if (ready == -1) {
+                if (errno == EINTR)
+                    continue;
+                failed = true;
+                break;
+            }
+            if (ready == 0)
+                break;
+
+            if (fds[1].revents)
+                return;
+
+            ssize_t n = read(fd_, buffer.data.get() + buffer.size, bufferSize_ - buffer.size);
+            if (n == -1) {
+                if (errno == EINTR || errno == EAGAIN)
+                    continue;
+                failed = true;
+                break;
+            }
+            if (n == 0) {
+                end = true;
+                break;
+            }
+            buffer.size += n;
+        }
+        Stats::global().add(Stats::Counter::BytesRead, buffer.size);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            filledBuffers_.push_back(i);
+            if (end || failed) {
+                done_ = true;
+                failed_ = failed;
+            }
+        }
+        condition_.notify_all();
+
+        if (end || failed)
+            return;
+    }
+}
+
+bool PipelinedTSVReader::nextBuffer()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (current_ != NoBuffer) {
+        freeBuffers_.push_back(current_);
+        current_ = NoBuffer;
+        condition_.notify_all();
+    }
+
+    condition_.wait(lock, [this] { return done_ || !filledBuffers_.empty(); });
+    if (filledBuffers_.empty())
+        return false;
+
+    current_ = filledBuffers_.front();
+    filledBuffers_.pop_front();
+    filled_ = std::string_view(buffers_[current_].data.get(), buffers_[current_].size);
+    scanner_ = DelimiterScanner(filled_);
+    pos_ = 0;
+    return true;
+}
+
+bool PipelinedTSVReader::readNextRow(LogRow& row)
+{
+    if (carryEmitted_) {
+        carry_.clear();
+        carryEmitted_ = false;
+    }
+
+    for (;;) {
+        if (pos_ < filled_.size()) {
+            if (carry_.empty()) {
+                std::size_t start = pos_;
+                if (scanner_.parseLine(pos_, row))
+                    return true;
+                pos_ = start;
+            } else {
+                // end of a line started in a previous buffer
+                std::size_t newline = scanner_.nextNewline(pos_);
+                if (newline != filled_.size()) {
+                    carry_.append(filled_.substr(pos_, newline - pos_));
+                    pos_ = newline + 1;
+                    parseRow(carry_, row);
+                    carryEmitted_ = true;
+                    return true;
+                }
+            }
+        }
+
+        // keep the start of a line split between buffers
+        carry_.append(filled_.substr(pos_));
+        filled_ = std::string_view();
+        pos_ = 0;
+
+        if (!nextBuffer()) {
+            // same semantics as std::getline(): the last line may not end
+            // with a newline
+            if (carry_.empty())
+                return false;
+
+            parseRow(carry_, row);
+            carryEmitted_ = true;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "delimiters.h"
+#include "row.h"
+
+//! Row reader over a file descriptor (typically a pipe), reading and parsing
+//! concurrently.
+//!
+//! A dedicated thread fills a ring of large buffers with big `read()` calls
+//! (as much as the input has available, up to the buffer size), while rows
+//! are parsed straight from the filled buffers (split in a single pass with a
+//! `DelimiterScanner`), so that the upstream process (e.g. a decompressor)
+//! never waits for the parsing, and vice versa. Only lines split between two
+//! buffers are copied.
+//!
+//! Views are invalidated by the next call to `readNextRow()`.
+class PipelinedTSVReader
+{
+public:
+    static const std::size_t DefaultBufferSize = 4 << 20;
+    static const std::size_t DefaultBufferCount = 4;
+
+    //! Start reading a file descriptor, which isn't closed by the reader.
+    explicit PipelinedTSVReader(int fd, std::size_t bufferSize = DefaultBufferSize,
+                                std::size_t bufferCount = DefaultBufferCount);
+
+    PipelinedTSVReader(const PipelinedTSVReader&) = delete;
+    PipelinedTSVReader& operator=(const PipelinedTSVReader&) = delete;
+
+    //! Stop the reading thread, even if the input wasn't read until its end.
+    ~PipelinedTSVReader();
+
+    bool readNextRow(LogRow& row);
+
+    //! Whether reading the input failed (rows read so far are still valid).
+    bool failed() const;
+
+private:
+    struct Buffer
+    {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+
+    void readLoop();
+
+    //! Wait for the next filled buffer, releasing the current one.
+    //!
+    //! @return false at the end of the input.
+    bool nextBuffer();
+
+    int fd_;
+    int wakeupPipe_[2];
+    std::size_t bufferSize_;
+    std::vector<Buffer> buffers_;
+
+    // shared with the reading thread
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<std::size_t> freeBuffers_;
+    std::deque<std::size_t> filledBuffers_;
+    bool done_;
+    bool failed_;
+    bool stopping_;
+
+    // parsing state
+    std::size_t current_;
+    std::string_view filled_;
+    DelimiterScanner scanner_;
+    std::size_t pos_;
+    std::string carry_;
+    bool carryEmitted_;
+
+    std::thread reader_;
+};
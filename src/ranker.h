@@ -1,64 +1,237 @@
 #pragma once
 
-#include <type_traits>
-#include <unordered_map>
-#include <map>
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <string_view>
+#include <utility>
+#include <vector>
 
-template <typename Owned, typename Ref = const Owned&>
+#include "interner.h"
+
+//! Ranks strings by their number of occurrences.
+//!
+//! Strings are interned to dense ids and counted in a flat array, so updates
+//! are amortized O(1) (independently of how many strings share the same
+//! count) and only allocate for the bytes of new distinct strings. The `n`
+//! highest ranked strings are only selected when visited, in O(d + n log n)
+//! for `d` distinct strings.
 class MaxOccurrenceRanker
 {
-    static_assert(std::is_constructible<Owned, Ref>::value,
-                  "Owned should be constructible from Ref");
-
 public:
     typedef unsigned int Count;
 
     //! Construct a ranker with the number of highest occurring elements to track.
-    explicit MaxOccurrenceRanker(Count n):
-        n_(n)
+    //!
+    //! @param[in] n The number of elements to rank.
+    //! @param[in] storage How updated strings are stored (see `StringInterner`).
+    explicit MaxOccurrenceRanker(Count n, StringInterner::Storage storage = StringInterner::Storage::Copy):
+        n_(n),
+        interner_(storage),
+        removed_(0)
     {
     }
 
-    //! Add a new element to the ranker, incrementing its rank,
+    //! Add occurrences of an element to the ranker, incrementing its rank,
     //! potentially including it in the `n` elements of highest rank.
-    void update(Ref element)
+    //!
+    //! @return The id of the element (see `remove()`).
+    StringInterner::Id update(std::string_view element, Count occurrences = 1)
     {
-        auto insertIt = occurrences_.emplace(element, 0).first;
-        const Owned& insertedElement = insertIt->first;
-        Count count = ++insertIt->second;
-
-        // erase an existing entry for this element
-        for (auto range = rankedOccurrences_.equal_range(count-1); range.first != range.second; ++range.first) {
-            if (range.first->second == element) {
-                rankedOccurrences_.erase(range.first);
-                break;
-            }
+        StringInterner::Id id = interner_.intern(element);
+        if (id == counts_.size()) {
+            counts_.push_back(0);
+            removed_++;
         }
+        if (counts_[id] == 0 && occurrences != 0)
+            removed_--;
+        counts_[id] += occurrences;
+        return id;
+    }
 
-        if (rankedOccurrences_.size() == n_) {
-            Count smallestCount = rankedOccurrences_.rbegin()->first;
-            if (count > smallestCount) {
-                rankedOccurrences_.emplace(count, insertedElement);
+    //! Remove occurrences of an element previously added, by its id,
+    //! decrementing its rank. Elements without any occurrence left are no
+    //! longer visited (but stay interned until `compact()`).
+    void remove(StringInterner::Id id, Count occurrences = 1)
+    {
+        counts_[id] -= occurrences;
+        if (counts_[id] == 0 && occurrences != 0)
+            removed_++;
+    }
 
-                // only keep the n max occurrences
-                rankedOccurrences_.erase(smallestCount);
+    //! Drop the elements without any occurrence left, so that they no longer
+    //! cost memory nor visiting time, renumbering the other elements.
+    //!
+    //! @return The new id of each previous id (unspecified for the dropped
+    //!         elements).
+    std::vector<StringInterner::Id> compact()
+    {
+        StringInterner interner(interner_.storage());
+        std::vector<Count> counts;
+        counts.reserve(counts_.size() - removed_);
+        std::vector<StringInterner::Id> ids(counts_.size(), 0);
+        for (StringInterner::Id id = 0; id < counts_.size(); id++) {
+            if (counts_[id] != 0) {
+                ids[id] = interner.intern(interner_.get(id));
+                counts.push_back(counts_[id]);
             }
-        } else {
-            rankedOccurrences_.emplace(count, insertedElement);
         }
+
+        interner_ = std::move(interner);
+        counts_ = std::move(counts);
+        removed_ = 0;
+        return ids;
+    }
+
+    //! Add all occurrences counted by another ranker.
+    void merge(const MaxOccurrenceRanker& other)
+    {
+        for (StringInterner::Id id = 0; id < other.counts_.size(); id++)
+            update(other.interner_.get(id), other.counts_[id]);
     }
 
-    //! Visit the `n` elements of highest rank.
+    //! Number of distinct elements added (since the last `compact()`).
+    std::size_t size() const
+    { return counts_.size(); }
+
+    //! Number of elements without any occurrence left, dropped by `compact()`.
+    std::size_t removedCount() const
+    { return removed_; }
+
+    //! Number of buckets of the table interning the elements.
+    std::size_t bucketCount() const
+    { return interner_.bucketCount(); }
+
+    //! Visit the `n` elements of highest rank, by decreasing rank.
+    //!
+    //! Elements with the same number of occurrences are ranked by increasing
+    //! value, so that the result doesn't depend on the order of the updates.
+    //! Elements whose occurrences were all removed aren't visited.
     template <typename F>
     void visit(F f) const
     {
-        for (const std::pair<Count, Ref>& p : rankedOccurrences_) {
-            f(p.second, p.first);
+        std::vector<StringInterner::Id> ranked(counts_.size());
+        for (StringInterner::Id id = 0; id < ranked.size(); id++)
+            ranked[id] = id;
+
+        // highest counts first, ties broken by element
+        auto rankComparator = [this](StringInterner::Id lhs, StringInterner::Id rhs) {
+            if (counts_[lhs] != counts_[rhs])
+                return counts_[lhs] > counts_[rhs];
+            return interner_.get(lhs) < interner_.get(rhs);
+        };
+
+        // select the n highest in O(d), then only sort them
+        auto rankedEnd = ranked.begin() + std::min<std::size_t>(n_, ranked.size());
+        if (rankedEnd != ranked.end())
+            std::nth_element(ranked.begin(), rankedEnd, ranked.end(), rankComparator);
+        std::sort(ranked.begin(), rankedEnd, rankComparator);
+
+        // removed elements are ranked last
+        for (auto it = ranked.begin(); it != rankedEnd && counts_[*it] != 0; ++it) {
+            f(interner_.get(*it), counts_[*it]);
+        }
+    }
+
+private:
+    Count n_;
+    StringInterner interner_;
+    std::vector<Count> counts_;
+
+    // number of elements whose count is 0
+    std::size_t removed_;
+};
+
+//! Ranks strings by their number of occurrences, which only grow, keeping
+//! the `n` highest ranked strings selected as they are updated.
+//!
+//! Since counts only grow, a string can only enter the `n` highest when it is
+//! updated, by outranking the lowest of them. Updates are thus O(log n) (the
+//! `n` highest being kept in an ordered set), and visiting is O(n) whatever
+//! the number of distinct strings, e.g. to rank a growing log repeatedly.
+class GrowingRanker
+{
+public:
+    typedef MaxOccurrenceRanker::Count Count;
+
+    //! Construct a ranker with the number of highest occurring elements to track.
+    //!
+    //! @param[in] n The number of elements to rank.
+    //! @param[in] storage How updated strings are stored (see `StringInterner`).
+    explicit GrowingRanker(Count n, StringInterner::Storage storage = StringInterner::Storage::Copy):
+        n_(n),
+        interner_(storage)
+    {
+    }
+
+    //! Add occurrences of an element to the ranker, incrementing its rank,
+    //! potentially including it in the `n` elements of highest rank.
+    void update(std::string_view element, Count occurrences = 1)
+    {
+        StringInterner::Id id = interner_.intern(element);
+        if (id == counts_.size()) {
+            counts_.push_back(0);
+            ranked_.push_back(false);
+        }
+
+        Entry previous{ counts_[id], interner_.get(id), id };
+        counts_[id] += occurrences;
+        Entry entry{ counts_[id], previous.element, id };
+
+        if (ranked_[id]) {
+            top_.erase(previous);
+        } else if (top_.size() == n_) {
+            // the lowest ranked element makes room if outranked
+            if (n_ == 0 || !Ranks()(entry, *std::prev(top_.end())))
+                return;
+            ranked_[std::prev(top_.end())->id] = false;
+            top_.erase(std::prev(top_.end()));
         }
+        top_.insert(entry);
+        ranked_[id] = true;
+    }
+
+    //! Number of distinct elements ever added.
+    std::size_t size() const
+    { return counts_.size(); }
+
+    //! Number of buckets of the table interning the elements.
+    std::size_t bucketCount() const
+    { return interner_.bucketCount(); }
+
+    //! Visit the `n` elements of highest rank, by decreasing rank (elements
+    //! with the same number of occurrences being ranked by increasing value).
+    template <typename F>
+    void visit(F f) const
+    {
+        for (const Entry& entry : top_)
+            f(entry.element, entry.count);
     }
 
 private:
+    struct Entry
+    {
+        Count count;
+        std::string_view element;
+        StringInterner::Id id;
+    };
+
+    // highest counts first, ties broken by element
+    struct Ranks
+    {
+        bool operator()(const Entry& lhs, const Entry& rhs) const
+        {
+            if (lhs.count != rhs.count)
+                return lhs.count > rhs.count;
+            return lhs.element < rhs.element;
+        }
+    };
+
     Count n_;
-    std::unordered_map<Owned, Count> occurrences_;
-    std::multimap<Count, Ref, std::greater<Count>> rankedOccurrences_;
+    StringInterner interner_;
+    std::vector<Count> counts_;
+
+    // whether each element is among the n highest
+    std::vector<bool> ranked_;
+    std::set<Entry, Ranks> top_;
 };
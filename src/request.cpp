@@ -0,0 +1,85 @@
+#include "request.h"
+
+#include <sstream>
+#include <vector>
+
+#include "commands.h"
+
+namespace {
+
+//! Split a request line into its whitespace separated arguments.
+std::vector<std::string> splitArguments(std::string_view line)
+{
+    std::vector<std::string> arguments;
+    std::istringstream input{std::string(line)};
+    std::string argument;
+    while (input >> argument)
+        arguments.push_back(argument);
+    return arguments;
+}
+
+} // namespace
+
+RequestParser::RequestParser():
+    options_({
+            LongOption("from", ArgumentRequired, "Minimum (inclusive) timestamp to consider"),
+            LongOption("to", ArgumentRequired, "Maximum (inclusive) timestamp to consider"),
+            }),
+    parser_(options_)
+{
+}
+
+std::optional<std::string> RequestParser::parse(std::string_view line, Request& request) const
+{
+    request = Request();
+    request.text = line;
+
+    // the parser expects a program name, as in the command line
+    std::vector<std::string> words = splitArguments(line);
+    words.insert(words.begin(), "hnStat");
+    std::vector<char*> argv;
+    for (std::string& word : words)
+        argv.push_back(word.data());
+    argv.push_back(nullptr);
+
+    std::optional<Arguments> arguments;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        arguments = parser_.parse(static_cast<int>(words.size()), argv.data());
+    }
+    if (!arguments)
+        return "invalid options";
+
+    if (auto error = parseTimestampRange(*arguments, request.scan))
+        return error;
+
+    auto positionalArguments = arguments->getPositional();
+    auto command = positionalArguments.next();
+    if (!command)
+        return "no command specified";
+
+    if (*command == "top") {
+        auto count_str = positionalArguments.next();
+        if (!count_str)
+            return "no maximum number of elements given";
+
+        try {
+            int n = std::stoi(*count_str);
+            if (n < 0)
+                return "expected a positive integer, got " + *count_str;
+            request.command = Request::Command::Top;
+            request.n = n;
+        } catch (const std::logic_error&) {
+            return *count_str + " is not an integer";
+        }
+    } else if (*command == "distinct") {
+        request.command = Request::Command::Distinct;
+    } else {
+        return "unrecognized command " + *command;
+    }
+
+    if (auto extra = positionalArguments.next())
+        return "unexpected argument " + *extra;
+
+    return std::nullopt;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "options.h"
+#include "scan.h"
+
+//! A `top` or `distinct` command given as a single line, e.g.
+//! `top 10 --from 1438387200 --to 1438473599`.
+struct Request
+{
+    enum class Command
+    {
+        Top,
+        Distinct,
+    };
+
+    //! The request line, as given.
+    std::string text;
+
+    Command command = Command::Distinct;
+
+    //! Number of queries of a `top` command.
+    unsigned int n = 0;
+
+    //! Range of the command (other scan options are left to their default).
+    ScanOptions scan;
+};
+
+//! Parses request lines, with the same syntax as the command line.
+class RequestParser
+{
+public:
+    RequestParser();
+
+    //! Parse a request line.
+    //!
+    //! @return An error message if the line isn't a valid request.
+    std::optional<std::string> parse(std::string_view line, Request& request) const;
+
+private:
+    Options options_;
+    Parser parser_;
+
+    // getopt isn't reentrant, so requests are parsed one at a time
+    mutable std::mutex mutex_;
+};
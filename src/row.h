@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <tuple>
+
+#include "timestamp.h"
+
+//! Validity of a line parsed as a `Row`.
+enum class RowStatus
+{
+    Valid,
+    WrongColumnCount, //!< The line doesn't have exactly one column per field.
+    InvalidField,     //!< A column isn't a valid value of its field.
+};
+
+//! A row of a fixed schema, e.g. `Row<Timestamp, std::string_view>`.
+//!
+//! Each column is parsed as its field type (see `parseField()`) as soon as it
+//! is delimited (see `DelimiterScanner::parseLine()`), so malformed lines are
+//! rejected without building a vector of columns first.
+template <typename... Fields>
+struct Row
+{
+    static constexpr std::size_t ColumnCount = sizeof...(Fields);
+
+    std::tuple<Fields...> fields;
+    RowStatus status = RowStatus::Valid;
+
+    //! The first invalid column, if the status is `RowStatus::InvalidField`.
+    std::string_view invalidColumn;
+};
+
+//! Rows of the query logs: `timestamp\tquery`.
+typedef Row<Timestamp, std::string_view> LogRow;
+
+//! Parse a column as a field.
+//!
+//! @return false if the column isn't a valid value of the field.
+inline bool parseField(std::string_view column, std::string_view& field)
+{
+    field = column;
+    return true;
+}
+
+inline bool parseField(std::string_view column, Timestamp& field)
+{
+    auto timestamp = Timestamp::parse(column);
+    if (!timestamp)
+        return false;
+    field = *timestamp;
+    return true;
+}
@@ -0,0 +1,76 @@
+#include "scan.h"
+
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "index.h"
+
+const std::string StdinFilename = "-";
+
+std::string quote(std::string_view str)
+{
+    std::ostringstream stream;
+    stream << "\"" << str << "\"";
+    return stream.str();
+}
+
+void reportInvalidLine(std::string_view reason)
+{
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::cerr << "invalid line: " << reason << std::endl;
+}
+
+int openInput(const std::string& filename)
+{
+    if (filename == StdinFilename)
+        return STDIN_FILENO;
+    return open(filename.c_str(), O_RDONLY);
+}
+
+void closeInput(int fd)
+{
+    if (fd != STDIN_FILENO)
+        close(fd);
+}
+
+std::optional<std::string> expandInputs(const std::vector<std::string>& filenames, std::vector<std::string>& inputs)
+{
+    for (const std::string& filename : filenames) {
+        struct stat st;
+        if (filename == StdinFilename || stat(filename.c_str(), &st) == -1 || !S_ISDIR(st.st_mode)) {
+            inputs.push_back(filename);
+            continue;
+        }
+
+        DIR* dir = opendir(filename.c_str());
+        if (!dir)
+            return "directory " + quote(filename) + " not readable";
+
+        std::set<std::string> names;
+        while (struct dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] != '.')
+                names.insert(entry->d_name);
+        }
+        closedir(dir);
+
+        // indexes are sidecars of the other files, not inputs
+        std::set<std::string> indexes;
+        for (const std::string& name : names)
+            indexes.insert(Index::pathFor(name));
+
+        for (const std::string& name : names) {
+            std::string path = filename + "/" + name;
+            if (!indexes.count(name) && stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+                inputs.push_back(path);
+        }
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "chunks.h"
+#include "mapped_file.h"
+#include "pipelined_reader.h"
+#include "sorted_range.h"
+#include "stats.h"
+#include "timestamp.h"
+#include "tsv_reader.h"
+
+//! How the rows of an input are selected and scanned.
+struct ScanOptions
+{
+    //! Minimum (inclusive) timestamp of the rows to consider.
+    Timestamp from = Timestamp::Min;
+
+    //! Maximum (inclusive) timestamp of the rows to consider.
+    Timestamp to = Timestamp::Max;
+
+    //! Number of threads scanning in-memory inputs.
+    unsigned int threads = 1;
+
+    //! Whether the input is known to be sorted by timestamp.
+    bool sorted = false;
+};
+
+std::string quote(std::string_view str);
+
+//! Report an invalid line, serializing messages from concurrent scans.
+void reportInvalidLine(std::string_view reason);
+
+//! Call `f(timestamp, query)` on all valid rows of a reader, until it returns
+//! false. Invalid rows are reported and skipped.
+template <typename Reader, typename F>
+void onValidLines(Reader& reader, F f)
+{
+    // counted locally, only added to the statistics once
+    std::uint64_t lines = 0;
+    std::uint64_t invalid_columns = 0;
+    std::uint64_t invalid_timestamps = 0;
+
+    LogRow row;
+    while (reader.readNextRow(row)) {
+        lines++;
+        if (row.status == RowStatus::WrongColumnCount) {
+            invalid_columns++;
+            reportInvalidLine("expected 2 columns");
+            continue;
+        }
+
+        // only the timestamp can be invalid
+        if (row.status == RowStatus::InvalidField) {
+            invalid_timestamps++;
+            reportInvalidLine(quote(row.invalidColumn) + " is not a valid timestamp");
+            continue;
+        }
+
+        if (!f(std::get<Timestamp>(row.fields), std::get<std::string_view>(row.fields)))
+            break;
+    }
+
+    Stats& stats = Stats::global();
+    stats.add(Stats::Counter::LinesRead, lines);
+    stats.add(Stats::Counter::InvalidColumns, invalid_columns);
+    stats.add(Stats::Counter::InvalidTimestamps, invalid_timestamps);
+}
+
+//! Call `f(query)` (or `f(timestamp, query)`, if `f` takes the timestamp) on
+//! all valid rows of a reader within the scanned range.
+//!
+//! When the input is sorted, reading stops at the first row past the range.
+template <typename Reader, typename F>
+void onTimestampRange(Reader& reader, const ScanOptions& scan, F f)
+{
+    std::uint64_t rows_in_range = 0;
+    onValidLines(reader, [&](const Timestamp& timestamp, std::string_view query) {
+        if (scan.to < timestamp)
+            return !scan.sorted;
+        if (!(timestamp < scan.from)) {
+            rows_in_range++;
+            if constexpr (std::is_invocable_v<F&, const Timestamp&, std::string_view>) {
+                f(timestamp, query);
+            } else {
+                f(query);
+            }
+        }
+        return true;
+    });
+    Stats::global().add(Stats::Counter::RowsInRange, rows_in_range);
+}
+
+//! Accumulate the queries within the scanned range of in-memory buffers (e.g.
+//! several mapped files).
+//!
+//! The buffers are split in line-aligned chunks scanned by `scan.threads`
+//! threads, each calling `f(accumulator, query)` on its own accumulator
+//! (created by `make()`), or `f(accumulator, timestamp, query)` if `f` takes
+//! the timestamp. When the buffers are sorted, the range is first located in
+//! each buffer by bisection, so only the lines within the range are read (and
+//! buffers outside of the range aren't split at all).
+//!
+//! @return The accumulators of each chunk, in order.
+template <typename Make, typename F>
+auto accumulateChunks(std::vector<std::string_view> inputs, const ScanOptions& scan, Make make, F f)
+    -> std::vector<std::invoke_result_t<Make>>
+{
+    if (scan.sorted) {
+        for (std::string_view& input : inputs)
+            input = findSortedRange(input, scan.from, scan.to);
+    }
+
+    return mapChunks(inputs, scan.threads, [&](std::string_view chunk) {
+        auto accumulator = make();
+        MemoryTSVReader reader(chunk);
+        onTimestampRange(reader, scan, [&](const Timestamp& timestamp, std::string_view query) {
+            if constexpr (std::is_invocable_v<F&, decltype(accumulator)&, const Timestamp&, std::string_view>) {
+                f(accumulator, timestamp, query);
+            } else {
+                f(accumulator, query);
+            }
+        });
+        return accumulator;
+    });
+}
+
+//! Filename standing for the standard input.
+extern const std::string StdinFilename;
+
+//! Open an input file (or the standard input, see `StdinFilename`).
+//!
+//! @return The file descriptor, or -1 if the file couldn't be opened.
+int openInput(const std::string& filename);
+
+//! Close a file descriptor returned by `openInput()`.
+void closeInput(int fd);
+
+//! Add a list of input files to `inputs`, directories being replaced by the
+//! regular files they contain (sorted by name, skipping hidden files and
+//! indexes).
+//!
+//! @return An error message if a directory couldn't be read.
+std::optional<std::string> expandInputs(const std::vector<std::string>& filenames, std::vector<std::string>& inputs);
+
+//! Call `f` with the contents of the given file.
+//!
+//! Regular files are memory mapped and passed as a string view (which can be
+//! read without copying any line, and split between threads), other inputs
+//! (e.g. pipes) are passed as a `PipelinedTSVReader`, reading the input
+//! while its rows are parsed.
+//!
+//! @return false if the file couldn't be opened or read.
+template <typename F>
+bool withInput(const std::string& filename, F f)
+{
+    std::optional<Stats::ScopedPhase> phase(Stats::Phase::Open);
+    int fd = openInput(filename);
+    if (fd == -1)
+        return false;
+
+    bool read = true;
+    if (auto mapped_file = MappedFile::map(fd)) {
+        phase.emplace(Stats::Phase::Scan);
+        f(mapped_file->contents());
+    } else {
+        phase.emplace(Stats::Phase::Scan);
+        PipelinedTSVReader reader(fd);
+        f(reader);
+        read = !reader.failed();
+    }
+
+    closeInput(fd);
+    return read;
+}
+
+//! Call `f` with the contents of the given files.
+//!
+//! Regular files are memory mapped and passed together as a vector of string
+//! views, so that they can be split between threads as a whole. A single
+//! other input (e.g. a pipe) is passed as a `PipelinedTSVReader` (see
+//! `withInput()`), it can't be read along with other files.
+//!
+//! @return The first file which couldn't be opened or read (or mapped along
+//!         with other files), if any.
+template <typename F>
+std::optional<std::string> withInputs(const std::vector<std::string>& filenames, F f)
+{
+    std::optional<Stats::ScopedPhase> phase(Stats::Phase::Open);
+
+    std::vector<MappedFile> mapped_files;
+    for (const std::string& filename : filenames) {
+        int fd = openInput(filename);
+        if (fd == -1)
+            return filename;
+
+        auto mapped_file = MappedFile::map(fd);
+        if (!mapped_file && filenames.size() == 1) {
+            phase.emplace(Stats::Phase::Scan);
+            PipelinedTSVReader reader(fd);
+            f(reader);
+            bool read = !reader.failed();
+            closeInput(fd);
+            return read ? std::nullopt : std::optional<std::string>(filename);
+        }
+
+        closeInput(fd);
+        if (!mapped_file)
+            return filename;
+        mapped_files.push_back(std::move(*mapped_file));
+    }
+
+    std::vector<std::string_view> contents;
+    for (const MappedFile& mapped_file : mapped_files)
+        contents.push_back(mapped_file.contents());
+
+    phase.emplace(Stats::Phase::Scan);
+    f(contents);
+    return std::nullopt;
+}
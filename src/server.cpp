@@ -0,0 +1,139 @@
+#include "server.h"
+
+#include <cerrno>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "commands.h"
+
+namespace {
+
+//! Write a whole buffer to a socket, which may be closed by its peer.
+bool sendAll(int fd, std::string_view data)
+{
+    while (!data.empty()) {
+        ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent == -1)
+            return false;
+        data.remove_prefix(sent);
+    }
+    return true;
+}
+
+} // namespace
+
+Server::Server(const Index& index):
+    index_(index)
+{
+}
+
+std::string Server::answer(std::string_view line) const
+{
+    Index::RangeCounts counts;
+    return answer(line, counts);
+}
+
+std::string Server::answer(std::string_view line, Index::RangeCounts& counts) const
+{
+    auto start = std::chrono::steady_clock::now();
+
+    Request request;
+    if (auto error = parser_.parse(line, request))
+        return "error " + *error + "\n";
+
+    std::ostringstream output;
+    switch (request.command) {
+        case Request::Command::Top:
+            printTopN(index_, output, request.scan, request.n, counts);
+            break;
+
+        case Request::Command::Distinct:
+            printDistinctCount(index_, output, request.scan);
+            break;
+    }
+
+    std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - start;
+    output << "ok " << std::fixed << std::setprecision(3) << latency.count() << " ms\n";
+    return output.str();
+}
+
+void Server::serve(std::istream& input, std::ostream& output) const
+{
+    Index::RangeCounts counts;
+    std::string request;
+    while (std::getline(input, request))
+        output << answer(request, counts) << std::flush;
+}
+
+bool Server::listen(const std::string& path) const
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return false;
+    path.copy(address.sun_path, path.size());
+
+    // replace a socket left by a previous server, but nothing else
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+        return false;
+
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1
+            || ::listen(fd, SOMAXCONN) == -1) {
+        close(fd);
+        return false;
+    }
+
+    while (true) {
+        int connection = accept(fd, nullptr, nullptr);
+        if (connection == -1) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            close(fd);
+            return false;
+        }
+
+        std::thread([this, connection] {
+            serveConnection(connection);
+            close(connection);
+        }).detach();
+    }
+}
+
+void Server::serveConnection(int fd) const
+{
+    Index::RangeCounts counts;
+    std::string pending;
+    char buffer[4096];
+    while (true) {
+        ssize_t size = read(fd, buffer, sizeof(buffer));
+        if (size == -1 && errno == EINTR)
+            continue;
+        if (size <= 0)
+            break;
+        pending.append(buffer, size);
+
+        // answer all the complete request lines received so far
+        std::size_t begin = 0;
+        for (std::size_t end; (end = pending.find('\n', begin)) != std::string::npos; begin = end + 1) {
+            if (!sendAll(fd, answer(std::string_view(pending).substr(begin, end - begin), counts)))
+                return;
+        }
+        pending.erase(0, begin);
+    }
+
+    // a last request may not end with a newline
+    if (!pending.empty())
+        sendAll(fd, answer(pending, counts));
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "index.h"
+#include "request.h"
+
+//! Answers requests against a log loaded once (as an index).
+//!
+//! Requests are single lines (see `Request`), e.g. `top 10 --from X` or
+//! `distinct --to Y`.
+//!
+//! Each answer is the output of the command, followed by a status line:
+//! either `ok LATENCY ms` (the time spent answering the request) or
+//! `error MESSAGE`.
+class Server
+{
+public:
+    explicit Server(const Index& index);
+
+    //! Answer a request line.
+    std::string answer(std::string_view line) const;
+
+    //! Answer a request line, sharing `counts` with the previous requests of
+    //! the same input or connection.
+    std::string answer(std::string_view line, Index::RangeCounts& counts) const;
+
+    //! Answer the requests of an input, until its end.
+    void serve(std::istream& input, std::ostream& output) const;
+
+    //! Answer the requests of the connections to a Unix domain socket (each
+    //! connection served by its own thread), forever.
+    //!
+    //! Any socket previously bound to the path is replaced.
+    //!
+    //! @return false if the socket couldn't be listened on.
+    bool listen(const std::string& path) const;
+
+private:
+    //! Answer the requests of a socket connection, until it is closed.
+    void serveConnection(int fd) const;
+
+    const Index& index_;
+    RequestParser parser_;
+};
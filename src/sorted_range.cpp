@@ -0,0 +1,98 @@
+#include "sorted_range.h"
+
+#include <optional>
+
+namespace {
+
+//! Offset just after the end of the line containing `pos`.
+std::size_t lineEnd(std::string_view data, std::size_t pos)
+{
+    std::size_t newline = data.find('\n', pos);
+    return newline == std::string_view::npos ? data.size() : newline + 1;
+}
+
+//! Offset of the start of the line containing `pos`, not before `limit`.
+std::size_t lineStart(std::string_view data, std::size_t pos, std::size_t limit)
+{
+    while (pos > limit && data[pos - 1] != '\n')
+        pos--;
+    return pos;
+}
+
+//! Timestamp of the line starting at `pos`, if valid.
+std::optional<Timestamp> lineTimestamp(std::string_view data, std::size_t pos)
+{
+    std::string_view line = data.substr(pos, lineEnd(data, pos) - pos);
+    std::size_t tabPos = line.find('\t');
+    if (tabPos == std::string_view::npos)
+        return std::nullopt;
+    return Timestamp::parse(line.substr(0, tabPos));
+}
+
+//! Timestamp of the last line, if valid.
+std::optional<Timestamp> lastLineTimestamp(std::string_view data)
+{
+    if (data.empty())
+        return std::nullopt;
+
+    // a trailing newline ends the last line, it doesn't start a new one
+    std::size_t end = data.back() == '\n' ? data.size() - 1 : data.size();
+    return lineTimestamp(data, lineStart(data, end, 0));
+}
+
+//! Offset of the first line whose timestamp isn't before `timestamp` (if
+//! `inclusive`) or is after `timestamp` (otherwise).
+std::size_t lowerBound(std::string_view data, const Timestamp& timestamp, bool inclusive)
+{
+    // invariant: lines before `low` are before the bound, lines from `high`
+    // on are after it, both are line starts
+    std::size_t low = 0;
+    std::size_t high = data.size();
+    while (low < high) {
+        std::size_t mid = low + (high - low) / 2;
+        std::size_t start = lineStart(data, mid, low);
+
+        // skip invalid lines, they can't be compared
+        std::optional<Timestamp> found;
+        std::size_t pos = start;
+        while (pos < high && !(found = lineTimestamp(data, pos)))
+            pos = lineEnd(data, pos);
+
+        if (!found) {
+            high = start;
+            continue;
+        }
+
+        bool before = inclusive ? *found < timestamp : !(timestamp < *found);
+        if (before) {
+            low = lineEnd(data, pos);
+        } else {
+            high = start;
+        }
+    }
+    return low;
+}
+
+} // namespace
+
+std::string_view findSortedRange(std::string_view data, const Timestamp& start_timestamp, const Timestamp& end_timestamp)
+{
+    // buffers outside of the range are skipped from their first and last
+    // lines only
+    auto first = lineTimestamp(data, 0);
+    auto last = lastLineTimestamp(data);
+    if ((first && end_timestamp < *first) || (last && *last < start_timestamp))
+        return data.substr(0, 0);
+
+    std::size_t begin = 0;
+    if (Timestamp::Min < start_timestamp)
+        begin = lowerBound(data, start_timestamp, true);
+
+    std::size_t end = data.size();
+    if (end_timestamp < Timestamp::Max)
+        end = lowerBound(data, end_timestamp, false);
+
+    if (end < begin)
+        return data.substr(begin, 0);
+    return data.substr(begin, end - begin);
+}
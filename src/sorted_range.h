@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string_view>
+
+#include "timestamp.h"
+
+//! Find the lines of a time-sorted TSV buffer within a timestamp range.
+//!
+//! Both bounds are found by bisecting the buffer on byte offsets (realigned
+//! on line starts), so only O(log size) lines are parsed, and only the first
+//! and last lines when the buffer is entirely outside of the range. Invalid
+//! lines are skipped while bisecting, and kept in the result if they are
+//! between valid lines of the range, so that they still get reported by the
+//! caller.
+//!
+//! @param[in] data The buffer, whose lines must be sorted by timestamp.
+//! @param[in] start_timestamp Minimum (inclusive) timestamp of the range.
+//! @param[in] end_timestamp Maximum (inclusive) timestamp of the range.
+//!
+//! @return The lines of the buffer within the range, as a sub-buffer.
+std::string_view findSortedRange(std::string_view data, const Timestamp& start_timestamp, const Timestamp& end_timestamp);
@@ -0,0 +1,154 @@
+#include "space_saving.h"
+
+#include <algorithm>
+#include <cassert>
+
+SpaceSaving::SpaceSaving(std::size_t capacity):
+    capacity_(capacity)
+{
+    assert(capacity_ > 0);
+}
+
+void SpaceSaving::update(std::string_view element)
+{
+    auto findIt = index_.find(element);
+    if (findIt != index_.end()) {
+        std::size_t i = findIt->second;
+        counters_[i].count++;
+        siftDown(heapPos_[i]);
+        return;
+    }
+
+    if (counters_.size() < capacity_) {
+        insert(element, 1, 0);
+        return;
+    }
+
+    // replace the string of smallest count
+    std::size_t i = heap_.front();
+    Counter& counter = counters_[i];
+    index_.erase(counter.element);
+
+    counter.element.assign(element);
+    counter.error = counter.count;
+    counter.count++;
+
+    index_.emplace(counter.element, i);
+    siftDown(0);
+}
+
+void SpaceSaving::merge(const SpaceSaving& other)
+{
+    Count missing = missingCount();
+    Count other_missing = other.missingCount();
+
+    std::vector<Counter> merged;
+    merged.reserve(counters_.size() + other.counters_.size());
+
+    for (const Counter& other_counter : other.counters_) {
+        if (index_.count(other_counter.element) == 0)
+            merged.push_back({ other_counter.element, other_counter.count + missing, other_counter.error + missing });
+    }
+
+    // elements are moved out last, since `index_` keys are views on them
+    for (Counter& counter : counters_) {
+        auto findIt = other.index_.find(counter.element);
+        if (findIt != other.index_.end()) {
+            const Counter& other_counter = other.counters_[findIt->second];
+            merged.push_back({ std::move(counter.element), counter.count + other_counter.count, counter.error + other_counter.error });
+        } else {
+            merged.push_back({ std::move(counter.element), counter.count + other_missing, counter.error + other_missing });
+        }
+    }
+
+    // only keep the highest counts, ties broken by element as in `ranked()`
+    // (so that the kept strings don't depend on the order of the chunks)
+    if (merged.size() > capacity_) {
+        std::nth_element(merged.begin(), merged.begin() + capacity_, merged.end(), [](const Counter& lhs, const Counter& rhs) {
+            if (lhs.count != rhs.count)
+                return lhs.count > rhs.count;
+            return lhs.element < rhs.element;
+        });
+        merged.resize(capacity_);
+    }
+
+    counters_.clear();
+    heap_.clear();
+    heapPos_.clear();
+    index_.clear();
+    for (Counter& counter : merged)
+        insert(counter.element, counter.count, counter.error);
+}
+
+std::vector<const SpaceSaving::Counter*> SpaceSaving::ranked(std::size_t n) const
+{
+    std::vector<const Counter*> ranked;
+    ranked.reserve(counters_.size());
+    for (const Counter& counter : counters_)
+        ranked.push_back(&counter);
+
+    // highest counts first, ties broken by element
+    auto rankedEnd = ranked.begin() + std::min(n, ranked.size());
+    std::partial_sort(ranked.begin(), rankedEnd, ranked.end(), [](const Counter* lhs, const Counter* rhs) {
+        if (lhs->count != rhs->count)
+            return lhs->count > rhs->count;
+        return lhs->element < rhs->element;
+    });
+
+    ranked.erase(rankedEnd, ranked.end());
+    return ranked;
+}
+
+SpaceSaving::Count SpaceSaving::missingCount() const
+{
+    if (counters_.size() < capacity_)
+        return 0;
+    return counters_[heap_.front()].count;
+}
+
+void SpaceSaving::insert(std::string_view element, Count count, Count error)
+{
+    std::size_t i = counters_.size();
+    counters_.push_back({ std::string(element), count, error });
+    index_.emplace(counters_.back().element, i);
+
+    heap_.push_back(i);
+    heapPos_.push_back(heap_.size() - 1);
+    siftUp(heap_.size() - 1);
+}
+
+void SpaceSaving::siftDown(std::size_t pos)
+{
+    for (;;) {
+        std::size_t smallest = pos;
+        for (std::size_t child = 2 * pos + 1; child <= 2 * pos + 2 && child < heap_.size(); child++) {
+            if (counters_[heap_[child]].count < counters_[heap_[smallest]].count)
+                smallest = child;
+        }
+
+        if (smallest == pos)
+            return;
+
+        swapHeap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+void SpaceSaving::siftUp(std::size_t pos)
+{
+    while (pos > 0) {
+        std::size_t parent = (pos - 1) / 2;
+        if (!(counters_[heap_[pos]].count < counters_[heap_[parent]].count))
+            return;
+
+        swapHeap(pos, parent);
+        pos = parent;
+    }
+}
+
+void SpaceSaving::swapHeap(std::size_t lhs, std::size_t rhs)
+{
+    std::swap(heap_[lhs], heap_[rhs]);
+    heapPos_[heap_[lhs]] = lhs;
+    heapPos_[heap_[rhs]] = rhs;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//! Space-Saving summary, tracking the most frequent strings in bounded memory.
+//!
+//! At most `capacity` strings are counted. When a new string comes in and the
+//! summary is full, it replaces the string of smallest count, inheriting its
+//! count as a possible overestimation (its error). Every count is thus an
+//! upper bound of the real number of occurrences, which is at least the
+//! count minus its error; any string occurring more than `total / capacity`
+//! times is guaranteed to be tracked.
+//!
+//! Updates are O(log capacity) (the counters are kept in an indexed min-heap),
+//! and summaries of the same capacity can be merged. Memory grows with the
+//! number of strings tracked, not with the capacity.
+class SpaceSaving
+{
+public:
+    typedef unsigned int Count;
+
+    //! Construct an empty summary tracking at most `capacity` strings.
+    explicit SpaceSaving(std::size_t capacity);
+
+    SpaceSaving(SpaceSaving&&) = default;
+    SpaceSaving& operator=(SpaceSaving&&) = default;
+
+    SpaceSaving(const SpaceSaving&) = delete;
+    SpaceSaving& operator=(const SpaceSaving&) = delete;
+
+    //! Count an occurrence of a string.
+    void update(std::string_view element);
+
+    //! Merge another summary into this one.
+    //!
+    //! Strings missing from a full summary are accounted for with its smallest
+    //! count (as both count and error), then only the `capacity` highest
+    //! counts are kept.
+    void merge(const SpaceSaving& other);
+
+    //! Visit the `n` strings of highest count, by decreasing count.
+    //!
+    //! `f` is called with each string, its count, and the maximum
+    //! overestimation of its count (0 when the count is exact). Strings with
+    //! the same count are ranked by increasing value.
+    template <typename F>
+    void visit(std::size_t n, F f) const
+    {
+        for (const Counter* counter : ranked(n))
+            f(std::string_view(counter->element), counter->count, counter->error);
+    }
+
+private:
+    struct Counter
+    {
+        std::string element;
+        Count count;
+        Count error;
+    };
+
+    std::vector<const Counter*> ranked(std::size_t n) const;
+
+    //! Smallest count, if the summary is full (an upper bound of the count of
+    //! any string which isn't tracked).
+    Count missingCount() const;
+
+    void insert(std::string_view element, Count count, Count error);
+    void siftDown(std::size_t pos);
+    void siftUp(std::size_t pos);
+    void swapHeap(std::size_t lhs, std::size_t rhs);
+
+    std::size_t capacity_;
+
+    // a deque never moves its elements as it grows, so that `index_` keys
+    // (views on the elements) are never invalidated
+    std::deque<Counter> counters_;
+
+    // indices of counters, smallest count first
+    std::vector<std::size_t> heap_;
+    std::vector<std::size_t> heapPos_;
+
+    std::unordered_map<std::string_view, std::size_t> index_;
+};
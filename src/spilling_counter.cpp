@@ -0,0 +1,177 @@
+#include "spilling_counter.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+#include <unistd.h>
+
+#include "hash.h"
+#include "stats.h"
+
+namespace {
+
+// each level partitions on its own bits of the hash, from the highest ones
+const unsigned int PartitionBits = 6;
+const unsigned int MaxLevel = 8;
+
+static_assert(SpillingCounter::Partitions == 1 << PartitionBits, "partitions must match the partition bits");
+static_assert(PartitionBits * (MaxLevel + 1) <= 64, "not enough hash bits");
+
+//! Create an anonymous temporary file, in `$TMPDIR` (or `/tmp`).
+//!
+//! @return The file, or nullptr if it couldn't be created.
+std::FILE* createTemporaryFile()
+{
+    const char* directory = std::getenv("TMPDIR");
+    std::string path = std::string(directory && *directory ? directory : "/tmp") + "/hnStat.XXXXXX";
+
+    int fd = mkstemp(path.data());
+    if (fd == -1)
+        return nullptr;
+    unlink(path.c_str());
+
+    std::FILE* file = fdopen(fd, "w+b");
+    if (!file)
+        close(fd);
+    return file;
+}
+
+} // namespace
+
+SpillingCounter::SpillingCounter(std::size_t memory_limit, StringInterner::Storage storage):
+    SpillingCounter(memory_limit, storage, 0)
+{
+}
+
+SpillingCounter::SpillingCounter(std::size_t memory_limit, StringInterner::Storage storage, unsigned int level):
+    memoryLimit_(memory_limit),
+    storage_(storage),
+    level_(level),
+    failed_(false),
+    interner_(storage)
+{
+}
+
+void SpillingCounter::add(std::string_view str, Count occurrences)
+{
+    StringInterner::Id id = interner_.intern(str);
+    if (id != counts_.size()) {
+        counts_[id] += occurrences;
+        return;
+    }
+    counts_.push_back(occurrences);
+
+    // past the last level, partitions can't be split any further
+    std::size_t memory_usage = interner_.memoryUsage() + counts_.capacity() * sizeof(Count);
+    if (memory_usage > memoryLimit_ && level_ < MaxLevel && !failed_)
+        spill();
+}
+
+void SpillingCounter::merge(SpillingCounter&& other)
+{
+    for (StringInterner::Id id = 0; id < other.counts_.size(); id++)
+        add(other.interner_.get(id), other.counts_[id]);
+    other.clear();
+
+    for (File& file : other.files_)
+        files_.push_back(std::move(file));
+    other.files_.clear();
+
+    for (std::size_t partition = 0; partition < Partitions; partition++) {
+        spilled_[partition].insert(spilled_[partition].end(), other.spilled_[partition].begin(), other.spilled_[partition].end());
+        other.spilled_[partition].clear();
+    }
+
+    failed_ = failed_ || other.failed_;
+}
+
+std::size_t SpillingCounter::partitionOf(std::string_view str) const
+{
+    unsigned int shift = 64 - PartitionBits * (level_ + 1);
+    return (hashString(str) >> shift) & (Partitions - 1);
+}
+
+void SpillingCounter::spill()
+{
+    if (files_.empty()) {
+        std::FILE* file = createTemporaryFile();
+        if (!file) {
+            failed_ = true;
+            return;
+        }
+        files_.emplace_back(file);
+    }
+    std::FILE* file = files_.front().get();
+
+    // group the strings by partition (counting sort), so that each partition
+    // is written as a single run
+    std::vector<std::uint8_t> partitions(counts_.size());
+    std::array<std::size_t, Partitions + 1> starts = {};
+    for (StringInterner::Id id = 0; id < counts_.size(); id++) {
+        partitions[id] = static_cast<std::uint8_t>(partitionOf(interner_.get(id)));
+        starts[partitions[id] + 1]++;
+    }
+    for (std::size_t partition = 0; partition < Partitions; partition++)
+        starts[partition + 1] += starts[partition];
+
+    std::vector<StringInterner::Id> ids(counts_.size());
+    std::array<std::size_t, Partitions + 1> ends = starts;
+    for (StringInterner::Id id = 0; id < counts_.size(); id++)
+        ids[ends[partitions[id]]++] = id;
+
+    // runs are appended, after the runs of previous spills
+    if (std::fseek(file, 0, SEEK_END) != 0) {
+        failed_ = true;
+        return;
+    }
+    long offset = std::ftell(file);
+    long first_offset = offset;
+
+    for (std::size_t partition = 0; partition < Partitions; partition++) {
+        std::size_t size = 0;
+        for (std::size_t i = starts[partition]; i < starts[partition + 1]; i++) {
+            std::string_view str = interner_.get(ids[i]);
+            std::uint32_t header[2] = { counts_[ids[i]], static_cast<std::uint32_t>(str.size()) };
+            std::fwrite(header, sizeof(header), 1, file);
+            std::fwrite(str.data(), 1, str.size(), file);
+            size += sizeof(header) + str.size();
+        }
+
+        if (size != 0)
+            spilled_[partition].push_back(Run{ file, offset, size });
+        offset += size;
+    }
+
+    failed_ = failed_ || std::ferror(file);
+    Stats::global().add(Stats::Counter::BytesSpilled, offset - first_offset);
+    clear();
+}
+
+bool SpillingCounter::load(std::size_t partition, SpillingCounter& counter)
+{
+    std::string str;
+    for (const Run& run : spilled_[partition]) {
+        if (std::fseek(run.file, run.offset, SEEK_SET) != 0)
+            return false;
+
+        for (std::size_t read = 0; read < run.size; read += sizeof(std::uint32_t[2]) + str.size()) {
+            std::uint32_t header[2];
+            if (std::fread(header, sizeof(header), 1, run.file) != 1)
+                return false;
+
+            str.resize(header[1]);
+            if (std::fread(str.data(), 1, str.size(), run.file) != str.size())
+                return false;
+
+            counter.add(str, header[0]);
+        }
+    }
+    return true;
+}
+
+void SpillingCounter::clear()
+{
+    interner_ = StringInterner(storage_);
+    counts_ = std::vector<Count>();
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "interner.h"
+
+//! Counts the occurrences of strings within a memory budget.
+//!
+//! Strings are counted in memory (see `StringInterner`) until the table
+//! reaches the budget. Its (string, count) pairs are then spilled to a
+//! temporary file, as one run per hash partition, and the table is emptied.
+//! Each partition only holds a fraction of the distinct strings, so once all
+//! the strings are counted, the partitions are aggregated one at a time
+//! within the budget (partitions still too large being partitioned again on
+//! other bits of the hash).
+class SpillingCounter
+{
+public:
+    typedef unsigned int Count;
+
+    //! Number of partitions the spilled strings are split into.
+    static const std::size_t Partitions = 64;
+
+    //! @param[in] memory_limit Bytes the table may use before being spilled.
+    //! @param[in] storage How counted strings are stored (see `StringInterner`).
+    explicit SpillingCounter(std::size_t memory_limit, StringInterner::Storage storage = StringInterner::Storage::Copy);
+
+    SpillingCounter(SpillingCounter&&) = default;
+    SpillingCounter& operator=(SpillingCounter&&) = default;
+
+    //! Add occurrences of a string.
+    void add(std::string_view str, Count occurrences = 1);
+
+    //! Change the bytes the table may use, a table already beyond the new
+    //! limit being spilled on its next new string.
+    inline void setMemoryLimit(std::size_t memory_limit)
+    { memoryLimit_ = memory_limit; }
+
+    //! Add all the occurrences counted by another counter (with the same
+    //! storage), taking over its spilled runs and emptying it.
+    void merge(SpillingCounter&& other);
+
+    //! Call `f(str, count)` once per distinct string with its total count, in
+    //! no particular order, emptying the counter. Views are only valid during
+    //! the call.
+    //!
+    //! @return false if spilling failed (e.g. no space left in the temporary
+    //!         directory), the visited counts being then incomplete.
+    template <typename F>
+    bool visit(F f)
+    {
+        if (files_.empty()) {
+            for (StringInterner::Id id = 0; id < counts_.size(); id++)
+                f(interner_.get(id), counts_[id]);
+            clear();
+            return !failed_;
+        }
+
+        spill();
+        for (std::size_t partition = 0; partition < Partitions && !failed_; partition++) {
+            SpillingCounter counter(memoryLimit_, StringInterner::Storage::Copy, level_ + 1);
+            failed_ = !load(partition, counter) || !counter.visit(f);
+        }
+        for (std::vector<Run>& runs : spilled_)
+            runs.clear();
+        files_.clear();
+        return !failed_;
+    }
+
+private:
+    struct FileCloser
+    {
+        void operator()(std::FILE* file) const
+        { std::fclose(file); }
+    };
+
+    typedef std::unique_ptr<std::FILE, FileCloser> File;
+
+    //! Byte range of a spilled run.
+    struct Run
+    {
+        std::FILE* file;
+        long offset;
+        std::size_t size;
+    };
+
+    SpillingCounter(std::size_t memory_limit, StringInterner::Storage storage, unsigned int level);
+
+    //! Partition of a string at this counter's level.
+    std::size_t partitionOf(std::string_view str) const;
+
+    //! Write the table as one run per partition, then empty it.
+    void spill();
+
+    //! Add the occurrences of the runs of a partition to another counter.
+    //!
+    //! @return false if the runs couldn't be read.
+    bool load(std::size_t partition, SpillingCounter& counter);
+
+    //! Empty the table.
+    void clear();
+
+    std::size_t memoryLimit_;
+    StringInterner::Storage storage_;
+    unsigned int level_;
+    bool failed_;
+
+    StringInterner interner_;
+    std::vector<Count> counts_;
+
+    // temporary files, the first one being written by `spill()`
+    std::vector<File> files_;
+    std::array<std::vector<Run>, Partitions> spilled_;
+};
@@ -0,0 +1,193 @@
+#include "stats.h"
+
+#include <cstring>
+#include <iomanip>
+#include <optional>
+
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+const char* const PhaseNames[] = { "other", "open", "scan", "merge", "rank", "output" };
+
+const char* const CounterNames[] = { "bytes_read", "lines_read", "invalid_columns", "invalid_timestamps", "rows_in_range", "bytes_spilled" };
+
+const char* const HardwareCounterNames[] = { "cycles", "instructions", "cache_misses" };
+
+const std::uint64_t HardwareCounterConfigs[] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+};
+
+//! CPU time of the process, all threads included.
+std::chrono::nanoseconds processCpuTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+//! Open a hardware counter of the process, including the threads it will
+//! start, in user space only (which unprivileged processes are usually
+//! allowed to count).
+//!
+//! @return The file descriptor of the counter, or -1 if unavailable.
+int openHardwareCounter(std::uint64_t config)
+{
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+double milliseconds(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+} // namespace
+
+Stats::ScopedPhase::ScopedPhase(Phase phase):
+    recorded_(Stats::global().recording()),
+    previous_(recorded_ ? Stats::global().phase_ : Phase::Other)
+{
+    if (recorded_)
+        Stats::global().enter(phase);
+}
+
+Stats::ScopedPhase::~ScopedPhase()
+{
+    if (recorded_)
+        Stats::global().enter(previous_);
+}
+
+Stats& Stats::global()
+{
+    static Stats stats;
+    return stats;
+}
+
+Stats::Stats():
+    tableKeys_(0),
+    tableBuckets_(0),
+    started_(false),
+    phase_(Phase::Other)
+{
+    for (auto& counter : counters_)
+        counter = 0;
+    hardwareCounters_.fill(-1);
+}
+
+void Stats::setTable(std::size_t keys, std::size_t buckets)
+{
+    if (!recording())
+        return;
+
+    tableKeys_ = keys;
+    tableBuckets_ = buckets;
+}
+
+void Stats::start()
+{
+    for (std::size_t i = 0; i < hardwareCounters_.size(); i++)
+        hardwareCounters_[i] = openHardwareCounter(HardwareCounterConfigs[i]);
+
+    started_ = true;
+    thread_ = std::this_thread::get_id();
+    wallStart_ = phaseWallStart_ = std::chrono::steady_clock::now();
+    cpuStart_ = phaseCpuStart_ = processCpuTime();
+}
+
+bool Stats::recording() const
+{
+    return started_ && std::this_thread::get_id() == thread_;
+}
+
+void Stats::enter(Phase phase)
+{
+    auto wall = std::chrono::steady_clock::now();
+    auto cpu = processCpuTime();
+
+    Times& times = phases_[static_cast<std::size_t>(phase_)];
+    times.wall += wall - phaseWallStart_;
+    times.cpu += cpu - phaseCpuStart_;
+    phaseWallStart_ = wall;
+    phaseCpuStart_ = cpu;
+    phase_ = phase;
+}
+
+void Stats::report(std::ostream& output, Format format)
+{
+    // account for the current phase until now
+    enter(phase_);
+
+    auto wall = std::chrono::steady_clock::now() - wallStart_;
+    auto cpu = processCpuTime() - cpuStart_;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long peak_rss_kib = usage.ru_maxrss;
+
+    std::array<std::optional<std::uint64_t>, static_cast<std::size_t>(HardwareCounter::Count)> hardware_counts;
+    for (std::size_t i = 0; i < hardwareCounters_.size(); i++) {
+        std::uint64_t count;
+        if (hardwareCounters_[i] != -1 && read(hardwareCounters_[i], &count, sizeof(count)) == sizeof(count))
+            hardware_counts[i] = count;
+    }
+
+    double load_factor = tableBuckets_ == 0 ? 0.0 : static_cast<double>(tableKeys_) / tableBuckets_;
+
+    output << std::fixed << std::setprecision(3);
+    if (format == Format::Json) {
+        output << "{\"wall_ms\": " << milliseconds(wall) << ", \"cpu_ms\": " << milliseconds(cpu) << ", \"phases\": {";
+        for (std::size_t i = 0; i < phases_.size(); i++) {
+            output << (i == 0 ? "" : ", ") << '"' << PhaseNames[i] << "\": {\"wall_ms\": " << milliseconds(phases_[i].wall)
+                << ", \"cpu_ms\": " << milliseconds(phases_[i].cpu) << '}';
+        }
+        output << '}';
+        for (std::size_t i = 0; i < counters_.size(); i++)
+            output << ", \"" << CounterNames[i] << "\": " << counters_[i].load();
+        output << ", \"distinct_keys\": " << tableKeys_ << ", \"buckets\": " << tableBuckets_
+            << ", \"load_factor\": " << load_factor << ", \"peak_rss_kib\": " << peak_rss_kib;
+        for (std::size_t i = 0; i < hardware_counts.size(); i++) {
+            output << ", \"" << HardwareCounterNames[i] << "\": ";
+            if (hardware_counts[i]) {
+                output << *hardware_counts[i];
+            } else {
+                output << "null";
+            }
+        }
+        output << '}' << std::endl;
+    } else {
+        output << "wall: " << milliseconds(wall) << " ms, cpu: " << milliseconds(cpu) << " ms\n";
+        for (std::size_t i = 0; i < phases_.size(); i++) {
+            output << "phase " << PhaseNames[i] << ": wall " << milliseconds(phases_[i].wall)
+                << " ms, cpu " << milliseconds(phases_[i].cpu) << " ms\n";
+        }
+        for (std::size_t i = 0; i < counters_.size(); i++)
+            output << CounterNames[i] << ": " << counters_[i].load() << '\n';
+        output << "distinct_keys: " << tableKeys_ << '\n'
+            << "buckets: " << tableBuckets_ << " (load factor " << load_factor << ")\n"
+            << "peak_rss: " << peak_rss_kib << " KiB\n";
+        for (std::size_t i = 0; i < hardware_counts.size(); i++) {
+            output << HardwareCounterNames[i] << ": ";
+            if (hardware_counts[i]) {
+                output << *hardware_counts[i] << '\n';
+            } else {
+                output << "unavailable\n";
+            }
+        }
+        output.flush();
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <thread>
+
+//! Instrumentation of a run (see `--stats`).
+//!
+//! Records the wall and CPU time of each phase of the run, counters of the
+//! rows read, the size of the hash table of the result, the peak memory, and
+//! hardware counters (from `perf_event_open()`, when the kernel allows it).
+//!
+//! Counters are always collected, scans accumulating them locally and adding
+//! them once per chunk, so that they cost nothing per row. Phases and the
+//! result table are only recorded once `start()` is called, by the thread
+//! which called it: other threads (e.g. those serving connections, which run
+//! the same commands concurrently) leave them untouched.
+class Stats
+{
+public:
+    enum class Phase
+    {
+        Other,  //!< Outside of any other phase (e.g. parsing arguments).
+        Open,   //!< Opening and mapping the input or its index.
+        Scan,   //!< Parsing, filtering and aggregating the rows.
+        Merge,  //!< Merging the aggregates of the threads.
+        Rank,   //!< Selecting and formatting the results.
+        Output, //!< Writing the results.
+        Count,
+    };
+
+    enum class Counter
+    {
+        BytesRead,         //!< Bytes handed to the row readers.
+        LinesRead,         //!< Lines read, valid or not.
+        InvalidColumns,    //!< Lines rejected for not having 2 columns.
+        InvalidTimestamps, //!< Lines rejected for their timestamp.
+        RowsInRange,       //!< Valid rows within the requested range.
+        BytesSpilled,      //!< Bytes of counts spilled to temporary files.
+        Count,
+    };
+
+    enum class Format
+    {
+        Text,
+        Json,
+    };
+
+    //! Time attributed to a phase while the object lives, the time of nested
+    //! phases being attributed to them (nothing being recorded outside of the
+    //! thread which called `start()`).
+    class ScopedPhase
+    {
+    public:
+        explicit ScopedPhase(Phase phase);
+        ~ScopedPhase();
+
+        ScopedPhase(const ScopedPhase&) = delete;
+        ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+    private:
+        bool recorded_;
+        Phase previous_;
+    };
+
+    //! Statistics of the process.
+    static Stats& global();
+
+    //! Add to a counter (from any thread).
+    inline void add(Counter counter, std::uint64_t value)
+    { counters_[static_cast<std::size_t>(counter)].fetch_add(value, std::memory_order_relaxed); }
+
+    //! Record the number of keys and buckets of the hash table of the result
+    //! (from the thread which called `start()`).
+    void setTable(std::size_t keys, std::size_t buckets);
+
+    //! Start timing the phases of the calling thread, and opening the
+    //! hardware counters.
+    void start();
+
+    //! Print the statistics since `start()`.
+    void report(std::ostream& output, Format format);
+
+private:
+    struct Times
+    {
+        std::chrono::nanoseconds wall{ 0 };
+        std::chrono::nanoseconds cpu{ 0 };
+    };
+
+    enum class HardwareCounter
+    {
+        Cycles,
+        Instructions,
+        CacheMisses,
+        Count,
+    };
+
+    Stats();
+
+    //! Whether the calling thread records the phases and result table.
+    bool recording() const;
+
+    //! Attribute the time since the last phase change to the current phase,
+    //! then switch to another phase (only while recording).
+    void enter(Phase phase);
+
+    std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(Counter::Count)> counters_;
+    std::size_t tableKeys_;
+    std::size_t tableBuckets_;
+
+    // thread which called `start()`, recording the phases (set before any
+    // other thread is started)
+    bool started_;
+    std::thread::id thread_;
+    Phase phase_;
+    std::chrono::steady_clock::time_point wallStart_;
+    std::chrono::nanoseconds cpuStart_;
+    std::chrono::steady_clock::time_point phaseWallStart_;
+    std::chrono::nanoseconds phaseCpuStart_;
+    std::array<Times, static_cast<std::size_t>(Phase::Count)> phases_;
+
+    // file descriptors of the hardware counters, -1 if unavailable
+    std::array<int, static_cast<std::size_t>(HardwareCounter::Count)> hardwareCounters_;
+};
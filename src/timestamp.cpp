@@ -1,56 +1,91 @@
 #include "timestamp.h"
 
-const Timestamp Timestamp::Min("0");
-const Timestamp Timestamp::Max(Timestamp::Infinity {});
+#include <cstring>
+#include <limits>
 
-Timestamp::Timestamp(Str&& timestamp_str):
-    timestamp_str_(timestamp_str),
-    is_inf_(false)
+const Timestamp Timestamp::Min(0);
+const Timestamp Timestamp::Max(std::numeric_limits<Timestamp::Value>::max());
+
+namespace {
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+//! Parse exactly 8 digits packed in a little endian word.
+//!
+//! @return false if any of the 8 characters isn't a digit.
+inline bool parseEightDigits(const char* str, std::uint64_t& value)
 {
+    std::uint64_t word;
+    std::memcpy(&word, str, sizeof(word));
+
+    // every byte must be in ['0', '9']: high nibble is 3, and adding 6 to the
+    // low nibble must not carry into the high nibble
+    if (((word & 0xF0F0F0F0F0F0F0F0) | (((word + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4))
+            != 0x3333333333333333)
+        return false;
+
+    word -= 0x3030303030303030;
+
+    // combine pairs of digits, then pairs of pairs, then the two halves
+    word = (word * 10) + (word >> 8);
+    word = (((word & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) +
+            (((word >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+
+    value = word;
+    return true;
 }
 
-Timestamp::Timestamp(Infinity):
-    is_inf_(true)
+#else
+
+inline bool parseEightDigits(const char* str, std::uint64_t& value)
 {
+    value = 0;
+    for (int i = 0; i < 8; i++) {
+        unsigned int digit = static_cast<unsigned char>(str[i]) - '0';
+        if (digit > 9)
+            return false;
+        value = value * 10 + digit;
+    }
+    return true;
 }
 
+#endif
+
+} // namespace
+
 std::optional<Timestamp> Timestamp::parse(const Str& timestamp_str)
 {
-    if (timestamp_str.empty())
-        return {};
+    // fast path for the common 10 digit timestamps
+    if (timestamp_str.size() == 10) {
+        unsigned int high = static_cast<unsigned char>(timestamp_str[0]) - '0';
+        unsigned int low = static_cast<unsigned char>(timestamp_str[1]) - '0';
 
-    // only accept digitimestamp_str, since a timestamp is a positive integer
-    if (std::any_of(timestamp_str.begin(), timestamp_str.end(), [](char c) { return c < '0' || c > '9'; }))
-        return {};
+        Value value;
+        if (high > 9 || low > 9 || !parseEightDigits(timestamp_str.data() + 2, value))
+            return {};
 
-    // skip leading zeros
-    auto i = timestamp_str.find_first_not_of('0');
-    if (i == -1)
-        i = timestamp_str.size() - 1;
+        return Timestamp((high * 10 + low) * 100000000ULL + value);
+    }
 
-    return Timestamp(timestamp_str.substr(i));
-}
+    if (timestamp_str.empty())
+        return {};
 
-bool Timestamp::operator<(const Timestamp& other) const
-{
-    // infinity => bool ordering (false < true)
-    if (is_inf_ != other.is_inf_)
-        return is_inf_ < other.is_inf_;
+    Value value = 0;
+    for (char c : timestamp_str) {
+        // only accept digits, since a timestamp is a positive integer
+        unsigned int digit = static_cast<unsigned char>(c) - '0';
+        if (digit > 9)
+            return {};
 
-    // smaller timestamp strings => smaller timestamps
-    if (timestamp_str_.size() != other.timestamp_str_.size())
-        return timestamp_str_.size() < other.timestamp_str_.size();
+        if (value > (std::numeric_limits<Value>::max() - digit) / 10)
+            return {};
+        value = value * 10 + digit;
+    }
 
-    // same string size => lexicographical order
-    return timestamp_str_ < other.timestamp_str_;
+    return Timestamp(value);
 }
 
 std::ostream& operator<<(std::ostream& output, const Timestamp& timestamp)
 {
-    if (timestamp.is_inf_) {
-        output << "infinity";
-    } else {
-        output << timestamp.timestamp_str_;
-    }
-    return output;
+    return output << timestamp.value();
 }
@@ -1,24 +1,22 @@
 #include "tsv_reader.h"
 
-TSVReader::TSVReader(std::istream& input):
-    input_(input)
+#include "stats.h"
+
+MemoryTSVReader::MemoryTSVReader(std::string_view data):
+    data_(data),
+    pos_(0),
+    scanner_(data)
 {
+    Stats::global().add(Stats::Counter::BytesRead, data_.size());
 }
 
-bool TSVReader::readNextRow(std::vector<std::string_view>& row)
+bool MemoryTSVReader::readNextRow(LogRow& row)
 {
-    if (!input_ || !std::getline(input_, line_))
+    // same semantics as std::getline(): a trailing newline doesn't start a
+    // new (empty) line
+    if (pos_ >= data_.size())
         return false;
 
-    row.clear();
-    std::string_view line_view(line_);
-
-    std::size_t pos = 0;
-    do {
-        std::size_t tabPos = line_view.find('\t', pos);
-        row.emplace_back(line_view.substr(pos, tabPos));
-        pos = tabPos + 1;
-    } while (pos != 0); // npos + 1
-
+    scanner_.parseLine(pos_, row);
     return true;
 }
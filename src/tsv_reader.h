@@ -1,18 +1,24 @@
 #pragma once
 
-#include <istream>
-#include <string>
 #include <string_view>
-#include <vector>
 
-class TSVReader
+#include "delimiters.h"
+#include "row.h"
+
+//! Row reader over an in-memory buffer (typically a memory mapped file).
+//!
+//! Rows are views straight into the buffer, no line is ever copied, so they
+//! stay valid as long as the buffer does. Lines are parsed in a single pass,
+//! with a `DelimiterScanner`.
+class MemoryTSVReader
 {
 public:
-    TSVReader(std::istream& input);
+    MemoryTSVReader(std::string_view data);
 
-    bool readNextRow(std::vector<std::string_view>& row);
+    bool readNextRow(LogRow& row);
 
 private:
-    std::istream& input_;
-    std::string line_;
+    std::string_view data_;
+    std::size_t pos_;
+    DelimiterScanner scanner_;
 };
@@ -0,0 +1,133 @@
+#include "wavelet_matrix.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+const std::size_t BlockWords = 8;
+
+std::size_t bitWordCount(std::size_t size)
+{
+    return (size + 63) / 64;
+}
+
+//! Words of a level: its bits, then the popcount of the bits before each
+//! block (including one past the last block, so that the size can be ranked).
+std::size_t levelWordCount(std::size_t size)
+{
+    return bitWordCount(size) + bitWordCount(size) / BlockWords + 1;
+}
+
+} // namespace
+
+unsigned int WaveletMatrix::bitsFor(std::uint64_t max_value)
+{
+    unsigned int bits = 0;
+    while (bits < 64 && (max_value >> bits) != 0)
+        bits++;
+    return bits;
+}
+
+std::size_t WaveletMatrix::wordCount(std::size_t size, unsigned int bits)
+{
+    return bits + bits * levelWordCount(size);
+}
+
+void WaveletMatrix::build(const std::vector<std::uint64_t>& values, unsigned int bits, std::uint64_t* words)
+{
+    std::size_t size = values.size();
+    std::uint64_t* zeros = words;
+    std::uint64_t* level_words = words + bits;
+
+    std::vector<std::uint64_t> current = values, next(size);
+    for (unsigned int level = 0; level < bits; level++) {
+        std::uint64_t* level_bits = level_words + level * levelWordCount(size);
+        std::uint64_t* level_ranks = level_bits + bitWordCount(size);
+        unsigned int shift = bits - 1 - level;
+
+        std::fill(level_bits, level_bits + levelWordCount(size), 0);
+        for (std::size_t i = 0; i < size; i++) {
+            if ((current[i] >> shift) & 1)
+                level_bits[i / 64] |= std::uint64_t(1) << (i % 64);
+        }
+
+        std::uint64_t rank = 0;
+        for (std::size_t word = 0; word <= bitWordCount(size); word++) {
+            if (word % BlockWords == 0)
+                level_ranks[word / BlockWords] = rank;
+            if (word < bitWordCount(size))
+                rank += __builtin_popcountll(level_bits[word]);
+        }
+        zeros[level] = size - rank;
+
+        // stable partition on the bit of the level, zeros first
+        std::size_t zero = 0, one = zeros[level];
+        for (std::size_t i = 0; i < size; i++) {
+            if ((current[i] >> shift) & 1) {
+                next[one++] = current[i];
+            } else {
+                next[zero++] = current[i];
+            }
+        }
+        std::swap(current, next);
+    }
+}
+
+WaveletMatrix::WaveletMatrix():
+    size_(0),
+    bits_(0),
+    zeros_(nullptr),
+    levels_(nullptr)
+{
+}
+
+WaveletMatrix::WaveletMatrix(const std::uint64_t* words, std::size_t size, unsigned int bits):
+    size_(size),
+    bits_(bits),
+    zeros_(words),
+    levels_(words + bits)
+{
+}
+
+std::size_t WaveletMatrix::rank1(unsigned int level, std::size_t position) const
+{
+    const std::uint64_t* level_bits = levels_ + level * levelWordCount(size_);
+    const std::uint64_t* level_ranks = level_bits + bitWordCount(size_);
+
+    std::size_t word = position / 64;
+    std::size_t rank = level_ranks[word / BlockWords];
+    for (std::size_t i = word - word % BlockWords; i < word; i++)
+        rank += __builtin_popcountll(level_bits[i]);
+    if (position % 64 != 0)
+        rank += __builtin_popcountll(level_bits[word] & ((std::uint64_t(1) << (position % 64)) - 1));
+    return rank;
+}
+
+std::size_t WaveletMatrix::countLess(std::size_t begin, std::size_t end, std::uint64_t bound) const
+{
+    if (begin >= end)
+        return 0;
+    if (bits_ < 64 && (bound >> bits_) != 0)
+        return end - begin;
+
+    // follow the values sharing the prefix of the bound down the levels,
+    // counting those diverging with a lower bit
+    std::size_t count = 0;
+    for (unsigned int level = 0; level < bits_; level++) {
+        std::size_t begin_ones = rank1(level, begin);
+        std::size_t end_ones = rank1(level, end);
+        std::size_t begin_zeros = begin - begin_ones;
+        std::size_t end_zeros = end - end_ones;
+
+        if ((bound >> (bits_ - 1 - level)) & 1) {
+            count += end_zeros - begin_zeros;
+            begin = zeros_[level] + begin_ones;
+            end = zeros_[level] + end_ones;
+        } else {
+            begin = begin_zeros;
+            end = end_zeros;
+        }
+    }
+    return count;
+}
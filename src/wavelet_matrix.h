@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//! Wavelet matrix over a sequence of integers, stored as 64 bit words (so
+//! that it can be used straight from a memory mapping).
+//!
+//! Values are decomposed in `bits` levels of bit vectors (from the most
+//! significant bit), each level stably partitioning the values by their bit,
+//! zeros first. Counting the values below a bound within a range of positions
+//! then takes one rank query per level, each answered in O(1) from the
+//! cumulative popcounts of blocks of 512 bits, using
+//! `bits * (size / 64 + size / 512)` words.
+class WaveletMatrix
+{
+public:
+    //! Number of bits needed to store values up to `max_value`.
+    static unsigned int bitsFor(std::uint64_t max_value);
+
+    //! Number of words of the wavelet matrix of `size` values of `bits` bits.
+    static std::size_t wordCount(std::size_t size, unsigned int bits);
+
+    //! Serialize the wavelet matrix of a sequence of values (each below
+    //! `2^bits`) into `wordCount(values.size(), bits)` words.
+    static void build(const std::vector<std::uint64_t>& values, unsigned int bits, std::uint64_t* words);
+
+    //! An empty wavelet matrix.
+    WaveletMatrix();
+
+    //! View a serialized wavelet matrix.
+    WaveletMatrix(const std::uint64_t* words, std::size_t size, unsigned int bits);
+
+    //! Number of values within positions [begin, end) which are below `bound`.
+    std::size_t countLess(std::size_t begin, std::size_t end, std::uint64_t bound) const;
+
+private:
+    //! Number of ones of a level before a position.
+    std::size_t rank1(unsigned int level, std::size_t position) const;
+
+    std::size_t size_;
+    unsigned int bits_;
+
+    // number of zeros of each level
+    const std::uint64_t* zeros_;
+    const std::uint64_t* levels_;
+};